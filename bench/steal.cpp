@@ -0,0 +1,47 @@
+
+#include <iostream>
+#include <chrono>
+#include <vector>
+
+#include "mpits.h"
+
+#include "utils/logging.h"
+
+/**
+ * Skewed spawn pattern: all the tasks are created by the scheduler of the first node, 
+ * the remaining nodes only get work by stealing it. Each scheduler reports the number 
+ * of executed tasks and its busy time when finalized. 
+ *
+ * 	mpirun -np <N> --map-by node ./bench_steal <num_tasks> <width>
+ *
+ * With the global scheduling tier enabled the tasks are instead placed by the first 
+ * node on the whole allocation:
+ *
+ * 	mpirun -np <N> --map-by node -x MPITS_GLOBAL_SCHEDULER=1 ./bench_steal <num_tasks> <width>
+ */
+int main(int argc, char* argv[]) {
+
+	mpits::init(std::cout, INFO);
+
+	int n = argc > 1 ? atoi(argv[1]) : 1000;
+	int width = argc > 2 ? atoi(argv[2]) : 1;
+
+	int rank;
+	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+	if (rank == 0) {
+		auto start = std::chrono::high_resolution_clock::now();
+
+		std::vector<mpits::Task::TaskID> tids;
+		for (int i=0; i<n; ++i) {
+			tids.push_back( mpits::spawn("busy_kernel", width, width) );
+		}
+
+		for (auto tid : tids) { mpits::wait_for(tid); }
+
+		std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+		LOG(INFO) << n << " tasks of width " << width << " completed in " << elapsed.count() << " secs";
+	}
+
+	mpits::finalize();
+}
@@ -0,0 +1,75 @@
+#include <algorithm>
+#include <iostream>
+#include <chrono>
+#include <numeric>
+#include <vector>
+
+#include "mpits.h"
+
+#include "utils/logging.h"
+
+/**
+ * Tiny tasks: each spawned task fans out 1000 single-rank children doing no work, the 
+ * benchmark reports the number of tasks completed per second. It then measures the launch 
+ * latency, from spawn to the completion seen by wait, of single-rank tasks spawned one at 
+ * a time (mean and percentiles). The workers log the stacks they mapped and their peak 
+ * RSS on exit.
+ *
+ * 	mpirun -np <N> ./bench_tiny <num_tasks> [<num_latency_samples>]
+ *
+ * With inline execution the children are run by the worker which spawned them:
+ *
+ * 	mpirun -np <N> -x MPITS_INLINE_TASKS=1 ./bench_tiny <num_tasks>
+ *
+ * With bundling the children (leaf_kernel is flagged KernelDesc::BUNDLE) are dispatched 
+ * to the workers in bundles:
+ *
+ * 	mpirun -np <N> -x MPITS_BUNDLE_TASKS=1 ./bench_tiny <num_tasks>
+ */
+int main(int argc, char* argv[]) {
+
+	mpits::init(std::cout, INFO);
+
+	int n = argc > 1 ? atoi(argv[1]) : 10;
+	int samples = argc > 2 ? atoi(argv[2]) : 1000;
+
+	int rank;
+	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+	if (rank == 0) {
+		auto start = std::chrono::high_resolution_clock::now();
+
+		std::vector<mpits::Task::TaskID> tids;
+		for (int i=0; i<n; ++i) {
+			tids.push_back( mpits::spawn("fanout_kernel", 1, 1) );
+		}
+
+		mpits::wait_all(tids);
+
+		std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+		LOG(INFO) << n*1001 << " tasks completed in " << elapsed.count() << " secs (" 
+				  << n*1001/elapsed.count() << " tasks/sec)";
+
+		// launch latency, one task in flight at a time 
+		std::vector<double> latency;
+		for (int i=0; i<samples; ++i) {
+			auto begin = std::chrono::high_resolution_clock::now();
+			mpits::wait_all( { mpits::spawn("leaf_kernel", 1, 1) } );
+
+			std::chrono::duration<double, std::micro> cur = std::chrono::high_resolution_clock::now() - begin;
+			latency.push_back(cur.count());
+		}
+
+		if (!latency.empty()) {
+			std::sort(latency.begin(), latency.end());
+			auto percentile = [&](double p) { return latency[static_cast<size_t>(p * (latency.size()-1))]; };
+
+			LOG(INFO) << "Launch latency over " << latency.size() << " tasks (usecs): mean " 
+					  << std::accumulate(latency.begin(), latency.end(), 0.0) / latency.size() 
+					  << ", p50 " << percentile(0.5) << ", p90 " << percentile(0.9) 
+					  << ", p99 " << percentile(0.99) << ", max " << latency.back();
+		}
+	}
+
+	mpits::finalize();
+}
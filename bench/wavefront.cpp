@@ -0,0 +1,50 @@
+
+#include <iostream>
+#include <chrono>
+#include <vector>
+
+#include "mpits.h"
+
+#include "utils/logging.h"
+
+/**
+ * Wavefront over a NxN grid of tasks: the task (i,j) depends on (i-1,j) and (i,j-1), 
+ * the whole DAG is submitted upfront and released by the scheduler in topological 
+ * order. The elapsed time is compared with the critical path of the DAG, (2N-1) tasks 
+ * of 20 milliseconds each (see busy_kernel).
+ *
+ * 	mpirun -np <N> ./bench_wavefront <grid_size> <width>
+ */
+int main(int argc, char* argv[]) {
+
+	mpits::init(std::cout, INFO);
+
+	int n = argc > 1 ? atoi(argv[1]) : 16;
+	int width = argc > 2 ? atoi(argv[2]) : 1;
+
+	int rank;
+	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+	if (rank == 0) {
+		auto start = std::chrono::high_resolution_clock::now();
+
+		std::vector<mpits::Task::TaskID> grid(n*n);
+		for (int i=0; i<n; ++i) {
+			for (int j=0; j<n; ++j) {
+				mpits::Task::TaskIDList deps;
+				if (i > 0) { deps.push_back(grid[(i-1)*n+j]); }
+				if (j > 0) { deps.push_back(grid[i*n+j-1]); }
+
+				grid[i*n+j] = mpits::spawn("busy_kernel", width, width, deps);
+			}
+		}
+
+		mpits::wait_for(grid.back());
+
+		std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+		LOG(INFO) << n << "x" << n << " wavefront completed in " << elapsed.count() << " secs "
+				  << "(critical path: " << (2*n-1)*0.02 << " secs)";
+	}
+
+	mpits::finalize();
+}
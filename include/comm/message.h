@@ -13,6 +13,8 @@
 #include <boost/archive/text_iarchive.hpp>
 #include <boost/archive/text_oarchive.hpp>
 
+#include "object_ref.h"
+
 namespace boost {
 namespace serialization {
 
@@ -43,6 +45,14 @@ void serialize(Archive & ar, std::tuple<Args...> & t, unsigned int version) {
 
 
 namespace mpits {
+
+// Handles travel with the tasks in the messages of the runtime
+template <class Archive>
+void serialize(Archive& ar, ObjectRef& ref, const unsigned int) {
+	ar & ref.id;
+	ar & ref.size;
+}
+
 namespace comm {
 
 typedef unsigned char Byte;
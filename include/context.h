@@ -5,6 +5,8 @@
 #include <csignal>
 
 #include "task.h"
+#include "kernel_registry.h"
+#include "object_store.h"
 
 namespace mpits {
 
@@ -12,11 +14,14 @@ struct Role {
 	
 	enum RoleType { RT_SCHEDULER, RT_WORKER };
 
-	Role(const RoleType& type, const MPI_Comm& node_comm) : 
-		m_type(type), m_node_comm(node_comm) 
+	Role(const RoleType& type, const MPI_Comm& node_comm, int node) : 
+		m_type(type), m_node_comm(node_comm), m_node(node) 
 	{ 
 		MPI_Comm_size(node_comm, &m_node_size);
 		MPI_Comm_rank(node_comm, &m_node_rank);
+		MPI_Comm_rank(MPI_COMM_WORLD, &m_world_rank);
+
+		m_kernels.load( KernelRegistry::libraries() );
 	}
 
 	const RoleType& type() const { return m_type; }
@@ -27,11 +32,52 @@ struct Role {
 
 	int node_size() const { return m_node_size; }
 
+	int world_rank() const { return m_world_rank; }
+
+	// Index of the node, equal to the rank of its scheduler among the schedulers 
+	int node() const { return m_node; }
+
+	const KernelRegistry& kernels() const { return m_kernels; }
+
 	virtual void do_work() = 0;
 
-	virtual Task::TaskID spawn(const std::string& kernel, unsigned min, unsigned max) = 0;
+	virtual Task::TaskID spawn(const KernelRegistry::KernelID& 	kernel, 
+							   unsigned 				min, 
+							   unsigned 				max, 
+							   const Task::TaskIDList& 	deps,
+							   const std::string& 		args,
+							   const Task::InputList& 	inputs,
+							   const Task::FileList& 	files) = 0;
+
+	virtual TaskRange spawn_n(const KernelRegistry::KernelID& kernel, unsigned count, unsigned min, unsigned max) = 0;
+
+	virtual void wait_all(const Task::TaskIDList& tids) = 0;
+
+	virtual Task::TaskID wait_any(const Task::TaskIDList& tids) = 0;
 
-	virtual void wait_for(const Task::TaskID& tid) = 0;
+	/**
+	 * Sets the result of the running task, handed out by result() once the task completed 
+	 */
+	virtual void set_result(const std::string& result) = 0;
+
+	/**
+	 * Returns the result of a completed task (empty if the task set none), the result of 
+	 * a task is handed out only once
+	 */
+	virtual std::string result(const Task::TaskID& tid) = 0;
+
+	/**
+	 * Bookkeeping of the object store of the node, kept by the scheduler: registration 
+	 * of a new object and start/end of a mapping 
+	 */
+	virtual void store_insert(const ObjectRef& ref) = 0;
+
+	virtual void store_acquire(const ObjectID& id) = 0;
+
+	virtual void store_release(const ObjectID& id) = 0;
+
+	// Registration of the ring of a new stream, the tasks using it are started together 
+	virtual void stream_insert(const ObjectID& id) = 0;
 
 	virtual Task::TaskID get_tid() { } 
 
@@ -45,6 +91,10 @@ private:
 	MPI_Comm m_node_comm;
 	int 	 m_node_size;
 	int		 m_node_rank;
+	int 	 m_world_rank;
+	int 	 m_node;
+
+	KernelRegistry m_kernels;
 };
 
 } // end mpits namespace 
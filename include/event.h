@@ -149,6 +149,14 @@ struct EventHandler {
 
 	EventQueue& queue() { return m_event_queue; }
 
+	/**
+	 * Acquires the lock held while events are being served, threads other than the 
+	 * event handler use it to access the state shared with the handlers
+	 */
+	std::unique_lock<std::recursive_mutex> lock() { 
+		return std::unique_lock<std::recursive_mutex>(m_mutex); 
+	}
+
 	void operator()();
 
 private:
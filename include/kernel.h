@@ -0,0 +1,175 @@
+#pragma once
+
+#include <mpi.h>
+
+#include <cstring>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#include "kernel_registry.h"
+
+namespace mpits {
+
+void finalize();
+
+/**
+ * Context of a running task, kernels receive a pointer to it as their intptr_t argument. 
+ * The communicator is the first member, therefore untyped kernels can keep reading it 
+ * as *(MPI_Comm*)ptr.
+ */
+struct TaskContext {
+	MPI_Comm 		comm;
+
+	// packed arguments of the task 
+	const char* 	args;
+	size_t 			args_size;
+};
+
+namespace detail {
+
+	/**
+	 * Codec of the kernel arguments: trivially copyable values are copied as they are, 
+	 * strings and vectors of trivially copyable values are prefixed by their length. 
+	 * Using any other type as kernel argument is a compile time error, so is using a 
+	 * pointer: it is only valid within the process which spawned the task.
+	 */
+	template <typename T>
+	typename std::enable_if<std::is_trivially_copyable<T>::value>::type 
+	pack(std::string& buf, const T& value) {
+		static_assert(!std::is_pointer<T>::value, "Pointers cannot be passed as kernel arguments");
+		buf.append(reinterpret_cast<const char*>(&value), sizeof(T));
+	}
+
+	template <typename T>
+	typename std::enable_if<std::is_trivially_copyable<T>::value>::type 
+	unpack(const char*& ptr, T& value) {
+		std::memcpy(&value, ptr, sizeof(T));
+		ptr += sizeof(T);
+	}
+
+	inline void pack(std::string& buf, const std::string& value) {
+		pack(buf, value.size());
+		buf.append(value);
+	}
+
+	inline void unpack(const char*& ptr, std::string& value) {
+		size_t size;
+		unpack(ptr, size);
+		value.assign(ptr, size);
+		ptr += size;
+	}
+
+	template <typename T>
+	typename std::enable_if<std::is_trivially_copyable<T>::value>::type 
+	pack(std::string& buf, const std::vector<T>& value) {
+		static_assert(!std::is_pointer<T>::value, "Pointers cannot be passed as kernel arguments");
+		pack(buf, value.size());
+		buf.append(reinterpret_cast<const char*>(value.data()), value.size()*sizeof(T));
+	}
+
+	template <typename T>
+	typename std::enable_if<std::is_trivially_copyable<T>::value>::type 
+	unpack(const char*& ptr, std::vector<T>& value) {
+		size_t size;
+		unpack(ptr, size);
+		value.resize(size);
+		std::memcpy(value.data(), ptr, size*sizeof(T));
+		ptr += size*sizeof(T);
+	}
+
+	template <size_t... Idx>
+	struct Indices { };
+
+	template <size_t N, size_t... Idx>
+	struct MakeIndices : MakeIndices<N-1, N-1, Idx...> { };
+
+	template <size_t... Idx>
+	struct MakeIndices<0, Idx...> { typedef Indices<Idx...> type; };
+
+	template <typename... Args, size_t... Idx>
+	std::string pack_tuple(const std::tuple<Args...>& values, Indices<Idx...>) {
+		std::string buf;
+		int expand[] = { 0, (pack(buf, std::get<Idx>(values)), 0)... };
+		(void) expand;
+		return buf;
+	}
+
+	template <typename... Args, size_t... Idx>
+	void unpack_tuple(const char* ptr, std::tuple<Args...>& values, Indices<Idx...>) {
+		int expand[] = { 0, (unpack(ptr, std::get<Idx>(values)), 0)... };
+		(void) expand;
+	}
+
+	template <typename... Args>
+	std::string pack_args(const std::tuple<Args...>& values) {
+		return pack_tuple(values, typename MakeIndices<sizeof...(Args)>::type());
+	}
+
+	/**
+	 * Registers a typed kernel void F(MPI_Comm, Args...), the registered entry point 
+	 * unpacks the arguments of the task, invokes F and finalizes the task once F returns
+	 */
+	template <typename Sig, Sig F>
+	struct KernelRegistrar;
+
+	template <typename... Args, void (*F)(MPI_Comm, Args...)>
+	struct KernelRegistrar<void (*)(MPI_Comm, Args...), F> {
+
+		typedef std::tuple<typename std::decay<Args>::type...> ArgsTuple;
+
+		KernelRegistrar(const char* name, unsigned min, unsigned max, unsigned cost, unsigned flags=0) {
+			KernelDesc desc = { name, &entry, min, max, cost, flags };
+			KernelRegistry::add_static(desc, reinterpret_cast<const void*>(F));
+		}
+
+		static void entry(intptr_t ptr) {
+			const TaskContext& ctx = *reinterpret_cast<const TaskContext*>(ptr);
+
+			{
+				ArgsTuple values;
+				unpack_tuple(ctx.args, values, typename MakeIndices<sizeof...(Args)>::type());
+				invoke(ctx.comm, values, typename MakeIndices<sizeof...(Args)>::type());
+			}
+
+			// the arguments are released before leaving the stack of the task for good 
+			finalize();
+		}
+
+		template <size_t... Idx>
+		static void invoke(MPI_Comm comm, ArgsTuple& values, Indices<Idx...>) {
+			F(comm, std::get<Idx>(values)...);
+		}
+	};
+
+} // end namespace detail
+
+} // end namespace mpits
+
+/**
+ * Registers the typed kernel f, a function void f(MPI_Comm, Args...), with the default 
+ * group size [min,max] and the given cost hint (usecs). To be used at namespace scope 
+ * in the executable or in a kernel library. Typed kernels return instead of calling 
+ * mpits::finalize():
+ *
+ * 	void my_kernel(MPI_Comm comm, int n, std::vector<double> v) { ... }
+ * 	MPITS_KERNEL(my_kernel, 1, 4, 0);
+ *
+ * 	mpits::spawn(&my_kernel, 2, 2, 10, std::vector<double>(100));
+ */
+#define MPITS_KERNEL(f, min, max, cost) \
+	static mpits::detail::KernelRegistrar<decltype(&f), &f> mpits_kernel_##f(#f, min, max, cost)
+
+/**
+ * Registers the typed kernel f as a pure function of its arguments (see KernelDesc::PURE)
+ */
+#define MPITS_PURE_KERNEL(f, min, max, cost) \
+	static mpits::detail::KernelRegistrar<decltype(&f), &f> mpits_kernel_##f(#f, min, max, cost, mpits::KernelDesc::PURE)
+
+/**
+ * Registers the typed kernel f as a short kernel whose tasks may be bundled (see 
+ * KernelDesc::BUNDLE)
+ */
+#define MPITS_BUNDLED_KERNEL(f, min, max, cost) \
+	static mpits::detail::KernelRegistrar<decltype(&f), &f> mpits_kernel_##f(#f, min, max, cost, mpits::KernelDesc::BUNDLE)
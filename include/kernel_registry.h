@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace mpits {
+
+/**
+ * Descriptor of a kernel. Kernel libraries export a table of descriptors, terminated by 
+ * an entry with a null name, through the symbol KERNEL_TABLE (declared extern "C"):
+ *
+ * 	extern "C" mpits::KernelDesc mpits_kernels[] = {
+ * 		{ "my_kernel", my_kernel, 1, 4, 100, 0 },
+ * 		{ "my_pure_kernel", my_pure_kernel, 1, 1, 0, mpits::KernelDesc::PURE },
+ * 		{ nullptr, nullptr, 0, 0, 0, 0 }
+ * 	};
+ */
+struct KernelDesc {
+
+	/**
+	 * PURE: the result of the kernel only depends on its arguments and the kernel has no 
+	 * other effect, the scheduler completes repeated runs with the result of the first one
+	 *
+	 * BUNDLE: runs of the kernel are short and never wait for tasks other than their inline 
+	 * children, the scheduler may run several single rank tasks of the kernel back-to-back 
+	 * on one worker (see MPITS_BUNDLE_TASKS)
+	 */
+	enum Flags { PURE = 0x1, BUNDLE = 0x2 };
+
+	const char* 	name;
+	void 			(*entry)(intptr_t);
+
+	// group size used when spawned without specifying it
+	unsigned 		min;
+	unsigned 		max;
+
+	// expected cost of a run (in microseconds), 0 if unknown
+	unsigned 		cost;
+
+	unsigned 		flags;
+};
+
+#define KERNEL_TABLE "mpits_kernels"
+
+/**
+ * Kernels available to the runtime, loaded at startup from the libraries listed in 
+ * MPITS_KERNELS (colon separated, ./libkernels.so by default). Kernels are identified 
+ * by their position in the registry, therefore all the processes must load the same 
+ * libraries in the same order.
+ *
+ * Typed kernels (see kernel.h) register themselves during the static initialization of 
+ * the executable or of the library defining them, the registry picks them up when loaded.
+ */
+struct KernelRegistry {
+
+	typedef unsigned KernelID;
+
+	static const KernelID INVALID = ~0u;
+
+	KernelRegistry() { }
+
+	~KernelRegistry();
+
+	KernelRegistry(const KernelRegistry&) = delete;
+	KernelRegistry& operator=(const KernelRegistry&) = delete;
+
+	// Loads the descriptor tables of the given libraries 
+	void load(const std::vector<std::string>& libs);
+
+	// Libraries listed in MPITS_KERNELS
+	static std::vector<std::string> libraries();
+
+	/**
+	 * Records a kernel registered at static initialization time, fn is the address of 
+	 * the typed function implementing it 
+	 */
+	static void add_static(const KernelDesc& desc, const void* fn);
+
+	size_t size() const { return m_kernels.size(); }
+
+	// Returns the id of the kernel, INVALID if not registered 
+	KernelID id(const std::string& name) const {
+		auto fit = m_ids.find(name);
+		return fit == m_ids.end() ? INVALID : fit->second;
+	}
+
+	/**
+	 * Returns the id of the typed kernel implemented by fn, INVALID if not registered. Not 
+	 * an overload of id(): a kernel name given as a C string would resolve to it.
+	 */
+	KernelID fn_id(const void* fn) const {
+		auto fit = m_fn_ids.find(fn);
+		return fit == m_fn_ids.end() ? INVALID : fit->second;
+	}
+
+	const KernelDesc& operator[](const KernelID& id) const { return m_kernels[id]; }
+
+private:
+	// Registers the kernels added through add_static since the last call 
+	void load_static();
+
+	bool add(const KernelDesc& desc, const std::string& origin);
+
+	std::vector<void*> 							m_handles;
+	std::vector<KernelDesc> 					m_kernels;
+	std::unordered_map<std::string, KernelID> 	m_ids;
+	std::unordered_map<const void*, KernelID> 	m_fn_ids;
+};
+
+} // end namespace mpits
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <unordered_map>
+
+#include "kernel_registry.h"
+
+namespace mpits {
+
+/**
+ * Runtimes of the kernels observed by the scheduler, kept as a moving average over the runs 
+ * of each kernel. They size the bundles of narrow tasks dispatched to a single worker: the 
+ * shorter the kernel, the more of its tasks are run back-to-back.
+ */
+struct KernelStats {
+
+	// Accounts for a run of kernel which took runtime seconds 
+	void record(const KernelRegistry::KernelID& kernel, double runtime);
+
+	/**
+	 * Number of tasks running kernel which fill about target seconds, at most max. Returns 
+	 * 1 (no bundling) until enough runs of the kernel have been observed.
+	 */
+	unsigned bundle_size(const KernelRegistry::KernelID& kernel, double target, unsigned max) const;
+
+	unsigned runs(const KernelRegistry::KernelID& kernel) const;
+
+	// Average runtime of kernel (in seconds), 0 if it never ran 
+	double runtime(const KernelRegistry::KernelID& kernel) const;
+
+private:
+	struct Entry {
+		unsigned 	runs;
+		double 		runtime;
+
+		Entry() : runs(0), runtime(0) { }
+	};
+
+	std::unordered_map<KernelRegistry::KernelID, Entry> m_entries;
+};
+
+} // end namespace mpits
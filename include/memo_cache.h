@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <string>
+#include <unordered_map>
+
+#include "kernel_registry.h"
+
+namespace mpits {
+
+/**
+ * Results of the runs of pure kernels, kept by the scheduler and indexed by the id of the
+ * kernel and the bytes of the arguments. Lookups hash the call but a hit compares the
+ * whole call. Results are stored encoded as inline payloads, together with the arguments
+ * they were computed from; once they exceed the capacity the least recently used ones 
+ * are dropped.
+ */
+struct MemoCache {
+
+	typedef uint64_t Key;
+
+	// A run of a kernel: its id in the registry and its packed arguments
+	struct Call {
+		KernelRegistry::KernelID 	kernel;
+		std::string 				args;
+
+		bool operator==(const Call& other) const { 
+			return kernel == other.kernel && args == other.args; 
+		}
+	};
+
+	static Key key(const Call& call);
+
+	explicit MemoCache(size_t capacity) : m_capacity(capacity), m_used(0), m_hits(0) { }
+
+	/**
+	 * Copies the result cached for call into result, returns false if the call is not
+	 * cached
+	 */
+	bool lookup(const Call& call, std::string& result);
+
+	// Caches result for call, entries larger than the capacity are not cached
+	void insert(const Call& call, const std::string& result);
+
+	size_t capacity() const { return m_capacity; }
+
+	// Bytes used by the cached results and their arguments
+	size_t used() const { return m_used; }
+
+	size_t count() const { return m_entries.size(); }
+
+	size_t hits() const { return m_hits; }
+
+private:
+	// the calls are owned by the entries
+	typedef std::list<const Call*> LruList;
+
+	struct Entry {
+		std::string 		result;
+		LruList::iterator 	lru;
+	};
+
+	struct Hash {
+		size_t operator()(const Call& call) const { return key(call); }
+	};
+
+	size_t 									m_capacity;
+	size_t 									m_used;
+	size_t 									m_hits;
+
+	std::unordered_map<Call, Entry, Hash> 	m_entries;
+
+	// cached results, most recently used first
+	LruList 								m_lru;
+};
+
+} // end namespace mpits
@@ -1,15 +1,199 @@
 #pragma once 
 
 #include "task.h"
+#include "kernel.h"
+#include "object_store.h"
+#include "staging.h"
+#include "stream.h"
 #include "utils/logging.h"
 
 namespace mpits {
 
 void init(std::ostream& log_stream=std::cerr, const Level& level=DEBUG);
 
-Task::TaskID spawn(const std::string& kernel, unsigned min, unsigned max);
+/**
+ * Spawns a task running kernel on a group of [min,max] ranks. The task is held by the 
+ * scheduler until all the tasks in deps complete. 
+ */
+Task::TaskID spawn(const std::string& 		kernel, 
+				   unsigned 				min, 
+				   unsigned 				max, 
+				   const Task::TaskIDList& 	deps=Task::TaskIDList());
 
-void wait_for(const Task::TaskID& tid);
+/**
+ * Spawns a task running kernel on the group size given by the descriptor of the kernel
+ */
+Task::TaskID spawn(const std::string& kernel, const Task::TaskIDList& deps=Task::TaskIDList());
+
+/**
+ * Spawns a task passing it the arguments packed in args, the typed spawn below takes 
+ * care of packing them. The objects in inputs are the data read by the task, the 
+ * scheduler runs the task close to where they are stored. The files are staged on the 
+ * node running the task while it is queued, see staged_path.
+ */
+Task::TaskID spawn_packed(const std::string& 		kernel, 
+						  unsigned 					min, 
+						  unsigned 					max, 
+						  const std::string& 		args, 
+						  const Task::TaskIDList& 	deps=Task::TaskIDList(),
+						  const Task::InputList& 	inputs=Task::InputList(),
+						  const Task::FileList& 	files=Task::FileList());
+
+/**
+ * Path to read an input file declared at spawn from: its staged copy if present on 
+ * this node, the file itself otherwise. InputFile arguments are resolved already.
+ */
+std::string staged_path(const std::string& file);
+
+namespace detail {
+
+	// Id of the typed kernel implemented by fn, as recorded by its KernelRegistrar 
+	KernelRegistry::KernelID kernel_id(const void* fn);
+
+	// spawn_packed for a kernel resolved already 
+	Task::TaskID spawn_packed(const KernelRegistry::KernelID& 	kernel, 
+							  unsigned 							min, 
+							  unsigned 							max, 
+							  const std::string& 				args, 
+							  const Task::TaskIDList& 			deps,
+							  const Task::InputList& 			inputs,
+							  const Task::FileList& 			files);
+
+	// Objects and files passed as arguments are the inputs of the task 
+	template <typename T>
+	void collect_inputs(Task::InputList&, Task::FileList&, const T&) { }
+
+	inline void collect_inputs(Task::InputList& inputs, Task::FileList&, const ObjectRef& ref) { 
+		if (ref.id) { inputs.push_back(ref); }
+	}
+
+	inline void collect_inputs(Task::InputList& inputs, Task::FileList& files, const std::vector<ObjectRef>& refs) { 
+		for (const auto& ref : refs) { collect_inputs(inputs, files, ref); }
+	}
+
+	// the tasks at the ends of a stream run on the node of its ring 
+	inline void collect_inputs(Task::InputList& inputs, Task::FileList&, const StreamRef& ref) { 
+		if (ref.id) { inputs.push_back(ObjectRef{ref.id, ref.capacity}); }
+	}
+
+	inline void collect_inputs(Task::InputList&, Task::FileList& files, const InputFile& file) { 
+		files.push_back(file.path);
+	}
+
+	template <typename... Args, size_t... Idx>
+	void task_inputs(const std::tuple<Args...>& 	values, 
+					 Indices<Idx...>, 
+					 Task::InputList& 				inputs, 
+					 Task::FileList& 				files) 
+	{
+		int expand[] = { 0, (collect_inputs(inputs, files, std::get<Idx>(values)), 0)... };
+		(void) expand;
+	}
+
+} // end namespace detail
+
+/**
+ * Spawns a task running the typed kernel registered with MPITS_KERNEL, the arguments 
+ * are checked against the signature of the kernel at compile time
+ */
+template <typename... Args, typename... Values>
+Task::TaskID spawn(void (*kernel)(MPI_Comm, Args...), unsigned min, unsigned max, Values&&... values) {
+
+	static_assert(sizeof...(Args) == sizeof...(Values), "Wrong number of arguments for the kernel");
+
+	std::tuple<typename std::decay<Args>::type...> args(std::forward<Values>(values)...);
+
+	Task::InputList inputs;
+	Task::FileList files;
+	detail::task_inputs(args, typename detail::MakeIndices<sizeof...(Args)>::type(), inputs, files);
+
+	return detail::spawn_packed(detail::kernel_id(reinterpret_cast<const void*>(kernel)), min, max, 
+								detail::pack_args(args), Task::TaskIDList(), inputs, files);
+}
+
+/**
+ * Spawns count identical tasks with a single request, the tasks get contiguous tids
+ */
+TaskRange spawn_n(const std::string& kernel, unsigned count, unsigned min, unsigned max);
+
+/**
+ * Waits for the completion of the task and returns the result it set (empty if none), 
+ * a result is handed out only once. Collective over the group of the calling task.
+ */
+std::string wait_for(const Task::TaskID& tid);
+
+/**
+ * Waits for a task which returned a value with return_value<T>() and unpacks it 
+ */
+template <typename T>
+T wait_for(const Task::TaskID& tid) {
+	std::string buf = wait_for(tid);
+	assert(!buf.empty() && "The task did not return a value");
+
+	T value;
+	const char* ptr = buf.data();
+	detail::unpack(ptr, value);
+	return value;
+}
+
+/**
+ * Sets the result of the calling task, the value set by rank 0 of the group is handed to 
+ * the task waiting for it. Results larger than MPITS_SHM_THRESHOLD bytes are passed through 
+ * the shared memory of the node.
+ */
+void set_result(const std::string& result);
+
+/**
+ * Sets the result of the calling task packing value with the codec of the kernel arguments
+ */
+template <typename T>
+void return_value(const T& value) {
+	std::string buf;
+	detail::pack(buf, value);
+	set_result(buf);
+}
+
+/**
+ * Waits for the completion of all the given tasks, the calling task is suspended 
+ * only once.
+ *
+ * With MPITS_INLINE_TASKS set, the single-rank children of single-rank tasks (spawned 
+ * without deps, files or inputs of other nodes) run inline on the worker of their parent. 
+ * Such a child can only wait for its own inline children: waiting for a task it spawned 
+ * on wider groups, with deps or with files aborts the run. The same holds for the tasks 
+ * of kernels flagged KernelDesc::BUNDLE.
+ */
+void wait_all(const Task::TaskIDList& tids);
+
+/**
+ * Waits for the completion of any of the given tasks and returns its tid
+ */
+Task::TaskID wait_any(const Task::TaskIDList& tids);
+
+/**
+ * Stores an immutable buffer in the object store of the node and returns its handle. The 
+ * store keeps the object until it is evicted (least recently used first) to make room for 
+ * newer objects, objects mapped by a task are never evicted.
+ */
+ObjectRef put(const void* data, size_t size);
+
+inline ObjectRef put(const std::string& data) { return put(data.data(), data.size()); }
+
+/**
+ * Maps an object of the node read-only, without copying it. The view is invalid if the 
+ * object was evicted or was stored on another node.
+ */
+ObjectView get(const ObjectRef& ref);
+
+/**
+ * Creates a stream of capacity bytes on this node. The handle is passed to a producer 
+ * and a consumer task, which open it with StreamWriter<T> and StreamReader<T>: 
+ *
+ * 	StreamRef s = mpits::make_stream(1 << 20);
+ * 	mpits::spawn(&producer, 1, 1, s);
+ * 	mpits::spawn(&consumer, 1, 1, s);
+ */
+StreamRef make_stream(size_t capacity);
 
 void finalize();
 
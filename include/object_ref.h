@@ -0,0 +1,17 @@
+#pragma once
+
+namespace mpits {
+
+typedef unsigned long ObjectID;
+
+/**
+ * Handle of an immutable buffer in the object store of a node. Handles are trivially
+ * copyable, tasks pass them to other tasks as kernel arguments. The null handle (id 0)
+ * refers to the empty buffer.
+ */
+struct ObjectRef {
+	ObjectID 		id;
+	unsigned long 	size;
+};
+
+} // end namespace mpits
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <functional>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "object_ref.h"
+
+namespace mpits {
+
+/**
+ * Index of the objects of a node, kept by the scheduler. Objects live in POSIX shared
+ * memory and are mapped in place by the tasks reading them; the store counts the live
+ * mappings of each object and, once the objects exceed the capacity, evicts the least
+ * recently used ones among those which are not mapped.
+ *
+ * The index is a pure bookkeeping structure: the ids of the evicted objects are returned
+ * to the caller which removes their shared memory objects.
+ */
+struct ObjectStore {
+
+	typedef std::vector<ObjectID> ObjectList;
+
+	ObjectStore(size_t capacity) : m_capacity(capacity), m_used(0) { }
+
+	// Name of the shared memory object holding the object id
+	static std::string name(const ObjectID& id);
+
+	/**
+	 * Returns a new id, ids are generated by the processes creating the objects and store 
+	 * the index of their node in the highest 16 bits, followed by the pid of the creator 
+	 * (22 bits) and a counter
+	 */
+	static ObjectID next_id(unsigned node);
+
+	static unsigned node_of(const ObjectID& id) { return id >> 48; }
+
+	/**
+	 * Registers a new object of size bytes created by the rank (of the node) producer, 
+	 * returns the objects evicted to make room for it
+	 */
+	ObjectList insert(const ObjectID& id, size_t size, int producer=-1);
+
+	// Rank which created the object, -1 if unknown
+	int producer(const ObjectID& id) const;
+
+	// A task mapped the object, it is not evicted until released
+	void acquire(const ObjectID& id);
+
+	// A task unmapped the object, returns the objects evicted as a consequence
+	ObjectList release(const ObjectID& id);
+
+	// Removes every object from the index, returns the ones which were stored
+	ObjectList clear();
+
+	bool contains(const ObjectID& id) const;
+
+	/**
+	 * Registers the ring of a stream created by the rank (of the node) producer. Rings do 
+	 * not count towards the capacity and are never evicted, the reader of the stream 
+	 * removes its ring.
+	 */
+	void insert_stream(const ObjectID& id, int producer=-1);
+
+	bool is_stream(const ObjectID& id) const;
+
+	// A task using the stream was started, its endpoints are running (or ran) already
+	void start_stream(const ObjectID& id);
+
+	bool stream_started(const ObjectID& id) const;
+
+	// Forgets every stream, returns their ids
+	ObjectList clear_streams();
+
+	size_t capacity() const { return m_capacity; }
+
+	// Bytes used by the stored objects
+	size_t used() const { return m_used; }
+
+	size_t count() const { return m_lru.size(); }
+
+private:
+	typedef std::list<ObjectID> LruList;
+
+	/**
+	 * A task may map an object before its registration reaches the scheduler, the entry
+	 * then only counts the mappings until the object is inserted
+	 */
+	struct Entry {
+		size_t 				size;
+		unsigned 			refs;
+		int 				producer;
+		bool 				stored;
+		LruList::iterator 	lru;
+	};
+
+	size_t 								m_capacity;
+	size_t 								m_used;
+
+	std::unordered_map<ObjectID, Entry> m_entries;
+
+	// stored objects, most recently used first
+	LruList 							m_lru;
+
+	struct StreamEntry {
+		int 				producer;
+		bool 				started;
+	};
+
+	std::unordered_map<ObjectID, StreamEntry> m_streams;
+
+	// Evicts objects, other than keep, until the used bytes fit the capacity
+	ObjectList evict(const ObjectID& keep=0);
+};
+
+/**
+ * Read-only mapping of an object, the release callback is invoked when the view goes
+ * away. The view is invalid if the object was evicted or lives on another node.
+ */
+struct ObjectView {
+
+	typedef std::function<void (const ObjectID&)> ReleaseCallback;
+
+	ObjectView() : m_ref{0, 0}, m_addr(nullptr), m_valid(true) { }
+
+	ObjectView(const ObjectRef& ref, const ReleaseCallback& release);
+
+	ObjectView(ObjectView&& other);
+	ObjectView& operator=(ObjectView&& other);
+
+	ObjectView(const ObjectView&) = delete;
+	ObjectView& operator=(const ObjectView&) = delete;
+
+	~ObjectView() { reset(); }
+
+	bool valid() const { return m_valid; }
+
+	const char* data() const { return static_cast<const char*>(m_addr); }
+
+	size_t size() const { return m_valid ? m_ref.size : 0; }
+
+	const ObjectRef& ref() const { return m_ref; }
+
+private:
+	ObjectRef 			m_ref;
+	void* 				m_addr;
+	bool 				m_valid;
+	ReleaseCallback 	m_release;
+
+	void reset();
+};
+
+} // end namespace mpits
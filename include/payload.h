@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace mpits {
+
+/**
+ * Argument and result buffers of the tasks as they travel through the runtime. Buffers up
+ * to a threshold are carried inline by the messages, larger ones are written once into a
+ * POSIX shared memory object and only its name travels: the scheduler never copies them
+ * and the ranks of the node map the object in place.
+ *
+ * The encoded form of an empty buffer is empty, otherwise it is a tag byte followed either
+ * by the bytes of the buffer (INLINE) or by its size and the name of the object (SHARED).
+ * Shared memory objects are removed by an explicit release once the payload is consumed.
+ */
+struct Payload {
+
+	static const char INLINE = 'I';
+	static const char SHARED = 'S';
+
+	// Buffers larger than this many bytes go through shared memory, set by MPITS_SHM_THRESHOLD
+	static size_t threshold();
+
+	/**
+	 * Encodes the buffer data, buffers larger than threshold are copied into a new shared
+	 * memory object. Falls back to the inline form if the object cannot be created.
+	 */
+	static std::string encode(const std::string& data, size_t threshold=Payload::threshold());
+
+	static bool is_shared(const std::string& encoded) {
+		return !encoded.empty() && encoded[0] == SHARED;
+	}
+
+	// Size of the buffer carried by the payload
+	static size_t size(const std::string& encoded);
+
+	/**
+	 * Returns the inline form of the payload, used when it leaves the node. The shared
+	 * memory object (if any) is released.
+	 */
+	static std::string make_inline(const std::string& encoded);
+
+	// Removes the shared memory object of the payload, existing mappings stay valid
+	static void release(const std::string& encoded);
+
+	Payload() : m_data(nullptr), m_size(0), m_addr(nullptr), m_valid(true) { }
+
+	/**
+	 * View of the buffer carried by encoded: inline buffers are read from encoded, which
+	 * must outlive the view, shared ones are mapped read-only
+	 */
+	explicit Payload(const std::string& encoded);
+
+	Payload(Payload&& other);
+	Payload& operator=(Payload&& other);
+
+	Payload(const Payload&) = delete;
+	Payload& operator=(const Payload&) = delete;
+
+	~Payload();
+
+	// False if the shared memory object could not be mapped (e.g. it lives on another node)
+	bool valid() const { return m_valid; }
+
+	const char* data() const { return m_data; }
+
+	size_t size() const { return m_size; }
+
+	std::string str() const { return std::string(m_data, m_size); }
+
+private:
+	const char* 	m_data;
+	size_t 			m_size;
+
+	// address of the mapping of a shared payload
+	void* 			m_addr;
+	bool 			m_valid;
+
+	void unmap();
+};
+
+} // end namespace mpits
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace mpits {
+
+/**
+ * Allocator for the ranks of a node. Free ranks are kept as a bitset and allocations are
+ * resolved with word-level find-first-set/popcount operations, therefore acquiring a group
+ * of ranks costs a handful of word operations even on nodes with hundreds of cores.
+ *
+ * Ranks can be clustered into locality domains (sockets and NUMA nodes); when the domains
+ * are known the allocator tries to place the ranks of a task within a single domain.
+ *
+ * Pinned ranks (hosting suspended tasks) are handed out last: as long as the other free
+ * ranks can host a request they are masked out of the free set.
+ */
+struct RankAllocator {
+
+	typedef uint64_t 			Word;
+	typedef std::vector<Word> 	Mask;
+	typedef std::vector<int> 	RankList;
+
+	enum Placement { RP_ANY, RP_CONTIGUOUS, RP_SOCKET, RP_NUMA };
+
+	RankAllocator(unsigned size=0) :
+		m_size(size), m_free((size+WORD_BITS-1)/WORD_BITS, 0), m_pinned(m_free.size(), 0) { }
+
+	unsigned size() const { return m_size; }
+
+	// Number of free ranks
+	unsigned count() const;
+
+	bool empty() const { return count() == 0; }
+
+	bool is_free(int rank) const {
+		return (m_free[rank/WORD_BITS] >> (rank%WORD_BITS)) & 1;
+	}
+
+	void insert(int rank) { m_free[rank/WORD_BITS] |= Word(1) << (rank%WORD_BITS); }
+
+	void erase(int rank) { m_free[rank/WORD_BITS] &= ~(Word(1) << (rank%WORD_BITS)); }
+
+	void release(const RankList& ranks);
+
+	void pin(int rank) { m_pinned[rank/WORD_BITS] |= Word(1) << (rank%WORD_BITS); }
+
+	void unpin(int rank) { m_pinned[rank/WORD_BITS] &= ~(Word(1) << (rank%WORD_BITS)); }
+
+	bool is_pinned(int rank) const {
+		return (m_pinned[rank/WORD_BITS] >> (rank%WORD_BITS)) & 1;
+	}
+
+	/**
+	 * Acquires n ranks following the placement policy p, the selected ranks are appended
+	 * to the ranks list. Returns false (and leaves the allocator untouched) when the
+	 * request cannot be satisfied with the given policy.
+	 */
+	bool acquire(unsigned n, const Placement& p, RankList& ranks);
+
+	/**
+	 * Acquires n ranks trying the tightest placement first: same NUMA node, same socket,
+	 * contiguous range and finally any free rank. Pinned ranks are taken last.
+	 */
+	RankList acquire(unsigned n);
+
+	/**
+	 * Acquires n ranks as close as possible to rank: the rank itself if it is free, then 
+	 * ranks sharing its NUMA node or its socket. Falls back to acquire(n) when the domains 
+	 * of rank cannot host the task.
+	 */
+	RankList acquire_near(unsigned n, int rank);
+
+	/**
+	 * Sets the socket and NUMA domain of each rank, negative ids mean the domain of the
+	 * rank is unknown.
+	 */
+	void set_domains(const std::vector<int>& sockets, const std::vector<int>& numa_nodes);
+
+	/**
+	 * Reads the topology of the cpus (one per rank) from /sys/devices/system
+	 */
+	void load_topology(const std::vector<int>& cpus);
+
+	static const unsigned WORD_BITS = sizeof(Word)*8;
+
+private:
+	unsigned 			m_size;
+	Mask 				m_free;
+	Mask 				m_pinned;
+
+	std::vector<Mask> 	m_sockets;
+	std::vector<Mask> 	m_numa_nodes;
+
+	bool acquire_domain(unsigned n, const std::vector<Mask>& domains, RankList& ranks);
+	bool acquire_contiguous(unsigned n, RankList& ranks);
+
+	// Moves the first n ranks set in mask from the free set into ranks
+	void take(unsigned n, const Mask& mask, RankList& ranks);
+
+	RankList acquire_free(unsigned n);
+	RankList acquire_near_free(unsigned n, int rank);
+
+	/**
+	 * Removes the free pinned ranks from the free set when the other free ranks are at 
+	 * least n, returns the removed ranks (to be restored once the ranks are acquired) 
+	 */
+	Mask hide_pinned(unsigned n);
+	void restore(const Mask& hidden);
+};
+
+} // end namespace mpits
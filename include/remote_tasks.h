@@ -0,0 +1,31 @@
+#pragma once
+
+#include <set>
+
+#include "task.h"
+
+namespace mpits {
+
+/**
+ * Tasks created by a scheduler which are queued or running on other nodes. A task leaves 
+ * when it is forwarded, placed or stolen and is accounted for when it completes, wherever 
+ * that happens: on another node, or back on its owner if the owner stole it back. Until 
+ * then the task is not completed for its waiters and successors.
+ */
+struct RemoteTasks {
+
+	// The task was handed to another node
+	void leave(const Task::TaskID& tid) { m_tids.insert(tid); }
+
+	// The task completed, returns false if it was not away from its owner
+	bool complete(const Task::TaskID& tid) { return m_tids.erase(tid) > 0; }
+
+	bool contains(const Task::TaskID& tid) const { return m_tids.find(tid) != m_tids.end(); }
+
+	size_t size() const { return m_tids.size(); }
+
+private:
+	std::set<Task::TaskID> 	m_tids;
+};
+
+} // end namespace mpits
@@ -3,8 +3,19 @@
 
 #include <mpi.h>
 
+#include <deque>
+#include <random>
+#include <set>
+
 #include "context.h"
 #include "event.h"
+#include "kernel_stats.h"
+#include "memo_cache.h"
+#include "object_store.h"
+#include "rank_allocator.h"
+#include "remote_tasks.h"
+#include "span_policy.h"
+#include "staging.h"
 
 #include "comm/channel.h"
 
@@ -18,40 +29,247 @@ struct Scheduler : public Role {
 	typedef std::list<TaskPtr> TaskQueue;
 	typedef std::map<Task::TaskID, LocalTaskPtr> ActiveTasks;
 
-	Scheduler(const MPI_Comm& 	node_comm,
-			  const MPI_Comm& 	sched_comm,
-			  Pids&&	 		pids) 
+	/**
+	 * Load of a node as seen by the global scheduler: free ranks and queue length are 
+	 * updated by the deltas reported by the node, in_flight stores the width of the tasks 
+	 * placed on the node which are not yet reflected by its reports 
+	 */
+	struct NodeLoad {
+		int 					free;
+		int 					queued;
+		std::deque<unsigned> 	in_flight;
+		unsigned 				in_flight_ranks;
+
+		NodeLoad() : free(0), queued(0), in_flight_ranks(0) { }
+	};
+	typedef std::vector<NodeLoad> ClusterLoad;
+
+	/**
+	 * Co-allocation of the ranks of a task wider than a node: the local free ranks are 
+	 * taken first (therefore the group leader lives on this node) and the remaining ones 
+	 * are reserved on the peer schedulers, asked one at a time 
+	 */
+	struct SpanRequest {
+		TaskPtr 			task;
+		std::vector<int> 	local_ranks;
+		std::vector<int> 	group; 		// world ranks of the whole group 
+		std::vector<int> 	peers; 		// peers which reserved ranks for the task
+		int 				next_peer;
+		unsigned 			needed;
+		bool 				yielded; 	// gave way to a coordinator with a lower rank
+	};
+	typedef std::shared_ptr<SpanRequest> SpanRequestPtr;
+
+	// Ranks reserved by this node for tasks coordinated by other schedulers
+	typedef std::map<Task::TaskID, std::vector<int>> Reservations;
+
+	/**
+	 * Task held by the scheduler until its predecessors complete, tasks submitted to the 
+	 * global scheduler are placed once released
+	 */
+	struct BlockedTask {
+		TaskPtr 	task;
+		unsigned 	pending;
+		bool 		place;
+	};
+	typedef std::map<Task::TaskID, BlockedTask> BlockedTasks;
+	typedef std::map<Task::TaskID, Task::TaskIDList> Successors;
+
+	// Encoded results of the completed tasks created by this scheduler, kept until handed out
+	typedef std::map<Task::TaskID, std::string> Results;
+
+	// Kernels and arguments of the pending tasks running pure kernels created by this scheduler
+	typedef std::map<Task::TaskID, MemoCache::Call> MemoCalls;
+
+	/**
+	 * Suspended tasks are resumed on their original ranks. A woken task claims each of 
+	 * its ranks as soon as it is idle; busy ranks keep a queue of the woken tasks waiting 
+	 * for them (in wakeup order) and are handed over to the first one when released. 
+	 */
+	typedef std::deque<Task::TaskID> AffinityQueue;
+	typedef std::map<Task::TaskID, std::pair<LocalTaskPtr, unsigned>> WokenTasks;
+	typedef std::list<LocalTaskPtr> ResumeQueue;
+
+	Scheduler(const MPI_Comm& 			node_comm,
+			  const MPI_Comm& 			sched_comm,
+			  int 						node,
+			  Pids&&	 				pids,
+			  const std::vector<int>& 	cpus) 
 	: 
-		Role(Role::RT_SCHEDULER, node_comm),
+		Role(Role::RT_SCHEDULER, node_comm, node),
 		m_tid(0),
 		m_sched_comm(sched_comm),
 		m_pids(std::move(pids)),
 		m_rchan(m_handler),
 		m_schan(m_handler),
-		m_thr(std::ref(m_handler)) 
+		m_thr(std::ref(m_handler)),
+		m_free_ranks(node_size()),
+		m_affinity(node_size()),
+		m_pinned(node_size(), 0),
+		m_span_retries(0),
+		m_steal_pending(false),
+		m_steal_delay(0),
+		m_finalizing(false),
+		m_executed(0),
+		m_inlined(0),
+		m_busy(0),
+		m_global(getenv("MPITS_GLOBAL_SCHEDULER") != nullptr),
+		m_reported_free(0),
+		m_reported_queued(0),
+		m_placed(0),
+		m_bundling(getenv("MPITS_BUNDLE_TASKS") != nullptr),
+		m_store( (getenv("MPITS_STORE_CAPACITY") ? strtoul(getenv("MPITS_STORE_CAPACITY"), nullptr, 10) : 1024ul) << 20 ),
+		m_staging( (getenv("MPITS_STAGING_CAPACITY") ? strtoul(getenv("MPITS_STAGING_CAPACITY"), nullptr, 10) : 1024ul) << 20 ),
+		m_memo( (getenv("MPITS_MEMO_CAPACITY") ? strtoul(getenv("MPITS_MEMO_CAPACITY"), nullptr, 10) : 64ul) << 20 )
 	{ 
-		int n_workers;
-		MPI_Comm_size(node_comm, &n_workers);
-		for (int rank=1; rank<n_workers; ++rank) { m_free_ranks.insert(rank); }
+		MPI_Comm_rank(m_sched_comm, &m_sched_rank);
+		MPI_Comm_size(m_sched_comm, &m_sched_size);
+		m_rand.seed(m_sched_rank);
+		assert(m_sched_rank == node && "Node index does not match the rank of the scheduler");
+
+		// Translate the node ranks into ranks of MPI_COMM_WORLD, used to build the groups 
+		MPI_Group node_group, world_group;
+		MPI_Comm_group(node_comm, &node_group);
+		MPI_Comm_group(MPI_COMM_WORLD, &world_group);
+
+		std::vector<int> node_ranks(node_size());
+		for (int rank=0; rank<node_size(); ++rank) { node_ranks[rank] = rank; }
+
+		m_world_ranks.resize(node_size());
+		MPI_Group_translate_ranks(node_group, node_size(), &node_ranks.front(), 
+								  world_group, &m_world_ranks.front());
+		MPI_Group_free(&node_group);
+		MPI_Group_free(&world_group);
+
+		// Ranks of all the nodes available to the tasks, wider tasks can never be started 
+		unsigned ranks = node_size()-1;
+		MPI_Allreduce(&ranks, &m_cluster_ranks, 1, MPI_UNSIGNED, MPI_SUM, m_sched_comm);
+
+		if (global_tier() && m_sched_rank == 0) { m_cluster_load.resize(m_sched_size); }
+
+		for (int rank=1; rank<node_size(); ++rank) { m_free_ranks.insert(rank); }
+		m_free_ranks.load_topology(cpus);
+	}
+
+	int sched_rank() const { return m_sched_rank; }
+
+	int sched_size() const { return m_sched_size; }
+
+	const MPI_Comm& sched_comm() const { return m_sched_comm; }
+
+	unsigned cluster_ranks() const { return m_cluster_ranks; }
+
+	Task::TaskID next_tid() { return Task::make_tid(m_sched_rank, ++m_tid); }
+
+	// Reserves count contiguous tids, returns the first one
+	Task::TaskID next_tids(unsigned count) { 
+		Task::TaskID first = Task::make_tid(m_sched_rank, m_tid+1);
+		m_tid += count;
+		return first;
 	}
 
-	int sched_rank() const {
-		int sched_rank;
-		MPI_Comm_rank(m_sched_comm, &sched_rank);
-		return sched_rank;
+	/**
+	 * Reserves a block of count tids for a worker, returns the first one. Until the worker 
+	 * creates (or inlines) a task with one of them the tid is pending: the TASK_WAIT of a 
+	 * group may reach the scheduler before the TASK_CREATE sent by another rank.
+	 */
+	Task::TaskID lease_tids(unsigned count) {
+		Task::TaskID first = next_tids(count);
+		for (unsigned idx=0; idx<count; ++idx) { m_leased.insert(m_leased.end(), first+idx); }
+		return first;
+	}
+
+	// Marks a leased tid as used, returns false if it was not leased 
+	bool tid_used(const Task::TaskID& tid) { return m_leased.erase(tid) > 0; }
+
+	// Returns the rank of a randomly selected peer scheduler 
+	int random_peer() {
+		assert(m_sched_size > 1);
+		int peer = std::uniform_int_distribution<int>(0, m_sched_size-2)(m_rand);
+		return peer < m_sched_rank ? peer : peer+1;
 	}
 
-	size_t next_tid() { return ++m_tid; }
+	double jitter() { return std::uniform_real_distribution<double>(0, 1)(m_rand); }
 
 	const Pids& pid_list() const { return m_pids; }
 
+	std::vector<int> world_ranks(const std::vector<int>& ranks) const {
+		std::vector<int> ret(ranks.size());
+		for (size_t idx=0; idx<ranks.size(); ++idx) { ret[idx] = m_world_ranks[ranks[idx]]; }
+		return ret;
+	}
+
+	// Releases the ranks, ranks wanted by a woken task are handed over to it
 	void release_pids(const LocalTask::RankList& ranks) { 
-		for (auto rank : ranks) {
-			// assert( m_free_ranks.find(rank) == m_free_ranks.end() );
-			m_free_ranks.insert(rank);
+		for (int rank : ranks) {
+			auto& queue = m_affinity[rank];
+			if (queue.empty()) { 
+				assert(!m_free_ranks.is_free(rank) && "Releasing a rank which is already free");
+				m_free_ranks.insert(rank); 
+				continue;
+			}
+
+			auto fit = m_woken_tasks.find(queue.front());
+			assert(fit != m_woken_tasks.end());
+			queue.pop_front();
+
+			if (--fit->second.second == 0) {
+				m_resume_queue.push_back(fit->second.first);
+				m_woken_tasks.erase(fit);
+			}
+		}
+	}
+
+	// The coroutine of a suspended task is bound to the workers running it 
+	void task_suspended(const LocalTask& task) {
+		for (int rank : task.ranks()) { 
+			if (m_pinned[rank]++ == 0) { m_free_ranks.pin(rank); }
 		}
 	}
 
+	/**
+	 * Acquires n free ranks, close to the rank near if not negative, preferring the ones 
+	 * which do not host suspended tasks so that woken tasks are less likely to find their 
+	 * ranks busy 
+	 */
+	std::vector<int> acquire_ranks(unsigned n, int near=-1) { return m_free_ranks.acquire_near(n, near); }
+
+	/**
+	 * Marks a suspended task as ready to continue, it is resumed once all its original 
+	 * ranks are idle. The task stays among the active tasks in the meantime.
+	 */
+	void wake_task(const LocalTaskPtr& task) {
+		unsigned missing = 0;
+		for (int rank : task->ranks()) {
+			if (--m_pinned[rank] == 0) { m_free_ranks.unpin(rank); }
+
+			if (m_affinity[rank].empty() && m_free_ranks.is_free(rank)) {
+				m_free_ranks.erase(rank);
+				continue;
+			}
+			m_affinity[rank].push_back(task->tid());
+			++missing;
+		}
+
+		if (missing == 0) { 
+			m_resume_queue.push_back(task); 
+			return;
+		}
+		m_woken_tasks.insert( {task->tid(), {task, missing}} );
+	}
+
+	// True if a woken task waits for the rank to be released 
+	bool rank_wanted(int rank) const { return !m_affinity[rank].empty(); }
+
+	// Returns the next woken task whose ranks are all claimed, nullptr if none 
+	LocalTaskPtr next_resumable() {
+		if (m_resume_queue.empty()) { return LocalTaskPtr(); }
+
+		LocalTaskPtr t = m_resume_queue.front();
+		m_resume_queue.pop_front();
+		return t;
+	}
+
 	void do_work();
 	 
 	EventHandler& handler() { return m_handler; }
@@ -61,24 +279,32 @@ struct Scheduler : public Role {
 		m_ready_task_queue.push_back( task );
 	}
 
+	TaskQueue& ready_tasks() { return m_ready_task_queue; }
+
 	bool is_completed(const Task::TaskID& tid) {
 		auto fit = std::find_if(m_ready_task_queue.begin(), m_ready_task_queue.end(), 
 						[&](const TaskPtr& cur) { return cur->tid() == tid; });
 
 		return fit == m_ready_task_queue.end() && 
-			   m_active_tasks.find(tid) == m_active_tasks.end();
+			   m_leased.find(tid) == m_leased.end() && 
+			   m_active_tasks.find(tid) == m_active_tasks.end() && 
+			   !m_remote_tasks.contains(tid) && 
+			   m_blocked_tasks.find(tid) == m_blocked_tasks.end();
 	}
 
-	const std::set<int>& free_ranks() const { return m_free_ranks; }
-	std::set<int>& free_ranks() { return m_free_ranks; }
+	const RankAllocator& free_ranks() const { return m_free_ranks; }
+	RankAllocator& free_ranks() { return m_free_ranks; }
 
-	TaskPtr next_task() {
+	// Pops the first queued task which fits in the free ranks and is accepted, if any 
+	template <class Filter>
+	TaskPtr next_task(const Filter& accept) {
 		if(m_ready_task_queue.empty()) { return TaskPtr(); }
 
+		unsigned free = m_free_ranks.count();
 		for(auto it = m_ready_task_queue.begin(), end=m_ready_task_queue.end(); 
 				it != end; ++it) 
 		{
-			if ((*it)->min() <= m_free_ranks.size()) {
+			if ((*it)->min() <= free && accept(*it)) {
 				TaskPtr t = *it;
 				m_ready_task_queue.erase(it);
 				return t;
@@ -89,12 +315,131 @@ struct Scheduler : public Role {
 
 	void join() { m_thr.join(); }
 
-	Task::TaskID spawn(const std::string& kernel, unsigned min, unsigned max);
+	Task::TaskID spawn(const KernelRegistry::KernelID& 	kernel, 
+					   unsigned 				min, 
+					   unsigned 				max, 
+					   const Task::TaskIDList& 	deps, 
+					   const std::string& 		args,
+					   const Task::InputList& 	inputs,
+					   const Task::FileList& 	files);
+
+	TaskRange spawn_n(const KernelRegistry::KernelID& kernel, unsigned count, unsigned min, unsigned max);
+
+	void wait_all(const Task::TaskIDList& tids) { wait(tids, false); }
+
+	Task::TaskID wait_any(const Task::TaskIDList& tids) { return wait(tids, true); }
+
+	void set_result(const std::string& result);
+
+	std::string result(const Task::TaskID& tid);
+
+	/**
+	 * Objects stored by the tasks of this node, the capacity (in MiB) is set by 
+	 * MPITS_STORE_CAPACITY 
+	 */
+	ObjectStore& store() { return m_store; }
+	const ObjectStore& store() const { return m_store; }
 
-	void wait_for(const Task::TaskID& tid);
+	void store_insert(const ObjectRef& ref);
+
+	/**
+	 * Input files staged for the tasks queued on this node, the capacity (in MiB) is set 
+	 * by MPITS_STAGING_CAPACITY 
+	 */
+	StagingCache& staging() { return m_staging; }
+
+	void store_acquire(const ObjectID& id);
+
+	void store_release(const ObjectID& id);
+
+	void stream_insert(const ObjectID& id);
 
 	ActiveTasks& active_tasks() { return m_active_tasks; }
 
+	// Tasks created by this scheduler which have been stolen by other nodes
+	RemoteTasks& remote_tasks() { return m_remote_tasks; }
+
+	BlockedTasks& blocked_tasks() { return m_blocked_tasks; }
+
+	// Tasks blocked on the completion of each task 
+	Successors& successors() { return m_successors; }
+
+	Results& results() { return m_results; }
+
+	/**
+	 * Results of the pure kernels run by the tasks of this scheduler, the capacity (in 
+	 * MiB) is set by MPITS_MEMO_CAPACITY, 0 disables the cache 
+	 */
+	MemoCache& memo() { return m_memo; }
+
+	MemoCalls& memo_calls() { return m_memo_calls; }
+
+	// Removes the result of a task and returns it (encoded), empty if the task has none
+	std::string take_result(const Task::TaskID& tid) {
+		auto fit = m_results.find(tid);
+		if (fit == m_results.end()) { return std::string(); }
+
+		std::string result = std::move(fit->second);
+		m_results.erase(fit);
+		return result;
+	}
+
+	/**
+	 * When the global tier is enabled (MPITS_GLOBAL_SCHEDULER set in the environment 
+	 * of all the processes) the scheduler with rank 0 in the schedulers communicator 
+	 * places the tasks submitted by the main program on the node which fits them best
+	 */
+	bool global_tier() const { return m_global && m_sched_size > 1; }
+
+	// Load of each node, only maintained by the global scheduler 
+	ClusterLoad& cluster_load() { return m_cluster_load; }
+
+	// Load of this node at the time of the last report sent to the global scheduler
+	int& reported_free() { return m_reported_free; }
+	int& reported_queued() { return m_reported_queued; }
+
+	// Number of placements received from the global scheduler since the last report
+	unsigned& placed() { return m_placed; }
+
+	// Pending co-allocation coordinated by this scheduler (if any)
+	SpanRequestPtr& span() { return m_span; }
+
+	// Co-allocations which failed in a row, sets the backoff of the next attempt
+	unsigned& span_retries() { return m_span_retries; }
+
+	Reservations& reservations() { return m_reservations; }
+
+	bool& steal_pending() { return m_steal_pending; }
+	size_t& steal_delay() { return m_steal_delay; }
+
+	/**
+	 * Every node reached finalize: tasks are no longer stolen, the schedulers only wait 
+	 * for the replies to the requests in flight before shutting down 
+	 */
+	bool& finalizing() { return m_finalizing; }
+	MPI_Request& finalize_request() { return m_finalize_req; }
+
+	// Accounts for a task which completed its execution on this node
+	void task_executed(const LocalTask& task) {
+		std::chrono::duration<double> elapsed = 
+			std::chrono::high_resolution_clock::now() - task.start_time();
+		++m_executed;
+		m_busy += elapsed.count() * task.ranks().size();
+	}
+
+	/**
+	 * When bundling is enabled (MPITS_BUNDLE_TASKS set in the environment) queued single 
+	 * rank tasks running short kernels flagged KernelDesc::BUNDLE are dispatched to a 
+	 * worker in bundles
+	 */
+	bool bundling() const { return m_bundling; }
+
+	// Runtimes of the kernels executed on this node 
+	KernelStats& kernel_stats() { return m_kernel_stats; }
+
+	// Accounts for tasks which the workers executed inline, without scheduling them 
+	void tasks_inlined(size_t count) { m_inlined += count; }
+
 	void finalize();
 
 	virtual ~Scheduler() { }
@@ -103,9 +448,19 @@ struct Scheduler : public Role {
 	Scheduler(const Scheduler&) = delete;
 
 private:
+	Task::TaskID wait(const Task::TaskIDList& tids, bool any);
+
 	size_t			m_tid;
 
+	// tids leased to the workers which were not used yet 
+	std::set<Task::TaskID> m_leased;
+
 	MPI_Comm		m_sched_comm;
+	int 			m_sched_rank;
+	int 			m_sched_size;
+	unsigned 		m_cluster_ranks;
+
+	std::vector<int> m_world_ranks;
 	Pids			m_pids;
 
 	EventHandler 			m_handler;
@@ -117,7 +472,54 @@ private:
 	TaskQueue 				m_ready_task_queue;
 	ActiveTasks 			m_active_tasks;
 
-	std::set<int> 			m_free_ranks;
+	RankAllocator 			m_free_ranks;
+
+	std::vector<AffinityQueue> 	m_affinity;
+	WokenTasks 				m_woken_tasks;
+	ResumeQueue 			m_resume_queue;
+
+	// number of suspended tasks per rank 
+	std::vector<unsigned> 	m_pinned;
+
+	RemoteTasks 			m_remote_tasks;
+
+	BlockedTasks 			m_blocked_tasks;
+	Successors 				m_successors;
+
+	Results 				m_results;
+
+	SpanRequestPtr 			m_span;
+	Reservations 			m_reservations;
+	unsigned 				m_span_retries;
+
+	// work stealing state
+	std::mt19937 			m_rand;
+	bool 					m_steal_pending;
+	size_t 					m_steal_delay;
+
+	bool 					m_finalizing;
+	MPI_Request 			m_finalize_req;
+
+	// statistics
+	size_t 					m_executed;
+	size_t 					m_inlined;
+	double 					m_busy;
+
+	// global scheduling tier 
+	bool 					m_global;
+	ClusterLoad 			m_cluster_load;
+	int 					m_reported_free;
+	int 					m_reported_queued;
+	unsigned 				m_placed;
+
+	bool 					m_bundling;
+	KernelStats 			m_kernel_stats;
+
+	ObjectStore 			m_store;
+	StagingCache 			m_staging;
+
+	MemoCache 				m_memo;
+	MemoCalls 				m_memo_calls;
 };
 
 } // end namespace mpits 
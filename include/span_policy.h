@@ -0,0 +1,33 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+
+namespace mpits {
+
+/**
+ * Arbitration between co-allocations of tasks wider than a node. Every coordinator holds
+ * the free ranks of its own node while it reserves the rest from its peers, so two nodes
+ * with a wide task each would refuse each other forever. Coordinators are ordered by their
+ * rank in the schedulers communicator: a coordinator gives up the ranks it holds when one
+ * with a lower rank asks for them, and retries later. Failed attempts are retried after an
+ * exponential, randomised delay so that competing nodes fall out of step.
+ */
+struct SpanPolicy {
+
+	// The pending co-allocation of coordinator gives way to the one of requester
+	static bool yields(int coordinator, int requester) { return requester < coordinator; }
+
+	/**
+	 * Delay (in msecs) before the next attempt of a co-allocation which failed retries
+	 * times in a row, jitter is drawn uniformly from [0,1)
+	 */
+	static size_t retry_delay(size_t base, size_t max, unsigned retries, double jitter) {
+		size_t delay = base << std::min(retries, 16u);
+		delay = std::min(delay, max);
+		return delay / 2 + static_cast<size_t>(delay * jitter / 2);
+	}
+};
+
+} // end namespace mpits
+
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace mpits {
+
+/**
+ * Pool of coroutine stacks. Stacks are mapped with a guard page below them the first time 
+ * a size class is needed and then recycled: a released stack is handed out again by the 
+ * next allocation of its class (LIFO), while its memory is still hot in the caches. 
+ *
+ * Stacks are mapped without reserving swap space and only their top HOT_SIZE bytes stay 
+ * committed while they sit in the pool, the pages below are returned to the system. 
+ *
+ * Requested sizes are rounded up to a size class (a power of two number of pages, at 
+ * least MIN_STACK_SIZE). As for boost::context allocators, the pointer returned by 
+ * allocate is the top of the stack. 
+ */
+struct StackPool {
+
+	static const size_t MIN_STACK_SIZE = 64*1024;
+	static const size_t HOT_SIZE = 16*1024;
+
+	StackPool(size_t default_size, size_t max_cached=64);
+
+	~StackPool();
+
+	StackPool(const StackPool&) = delete;
+	StackPool& operator=(const StackPool&) = delete;
+
+	// Stack size used when none is requested, rounded to its size class
+	size_t default_size() const { return m_default_size; }
+
+	void* allocate(size_t size);
+	void* allocate() { return allocate(m_default_size); }
+
+	// Returns a stack obtained from allocate(size) to the pool 
+	void deallocate(void* sp, size_t size);
+
+	/**
+	 * Makes sure that the next allocation of size is served from the pool, mapping a stack 
+	 * and faulting in its top HOT_SIZE bytes if none is cached. Returns true if a stack 
+	 * was mapped.
+	 */
+	bool reserve(size_t size);
+
+	/**
+	 * Returns to the system the pages of a stack in use which lie entirely below the 
+	 * address low, they read as zero when touched again. Returns the number of bytes 
+	 * released.
+	 */
+	static size_t trim(void* sp, size_t size, void* low);
+
+	/**
+	 * Returns the number of bytes, from the top of the stack down to its deepest resident 
+	 * page, which were touched since the stack was allocated (page granularity). Pages 
+	 * below the top HOT_SIZE bytes are not resident when a stack is handed out.
+	 */
+	static size_t used(void* sp, size_t size);
+
+	// Number of stacks currently kept by the pool 
+	size_t cached() const;
+
+	// Number of stacks mapped since the pool was created 
+	size_t mapped() const { return m_mapped; }
+
+	static size_t size_class(size_t size);
+
+private:
+	typedef std::vector<void*> 	FreeList;
+
+	size_t 					m_default_size;
+	size_t 					m_max_cached;
+	size_t 					m_mapped;
+
+	// free stacks, indexed by the log2 of the size class 
+	std::vector<FreeList> 	m_free;
+
+	static unsigned class_index(size_t size);
+	static void unmap(void* sp, size_t size);
+};
+
+} // end namespace mpits
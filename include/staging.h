@@ -0,0 +1,113 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+
+#include "kernel.h"
+#include "object_store.h"
+
+namespace mpits {
+
+/**
+ * Node-local cache of the input files declared by the tasks. While a task is queued the
+ * scheduler copies its files, on a background thread, into the staging directory
+ * (MPITS_STAGING_DIR, /dev/shm by default) where every rank of the node reads them.
+ * Files are staged once per node and shared by all the tasks reading them; the tasks
+ * queued or running pin their files, the others are evicted (least recently used first)
+ * once the staged bytes exceed the capacity.
+ *
+ * Staged copies are named after the run (see job()) and carry the size and modification
+ * time of their source, a copy whose source changed is not used. A kernel starting before
+ * its files are staged reads them from their original location.
+ */
+struct StagingCache {
+
+	// Directory holding the staged files
+	static const std::string& directory();
+
+	/**
+	 * Token of the run included in the names of the staged copies, so that concurrent or 
+	 * earlier jobs sharing the directory never hand their copies out. All the processes 
+	 * of a run set the same token (the pid of world rank 0) at init, it defaults to the 
+	 * pid of the process.
+	 */
+	static unsigned long job();
+
+	static void set_job(unsigned long token);
+
+	// Key of a file in the cache
+	static ObjectID file_id(const std::string& file);
+
+	// Location of the staged copy of file
+	static std::string path(const std::string& file);
+
+	// Location of the staged copy of file if present on this node, file itself otherwise
+	static std::string lookup(const std::string& file);
+
+	/**
+	 * Copies file to path through a temporary file, so that readers never see a partial
+	 * copy. An existing copy is kept if it matches the size and modification time of 
+	 * file. Returns false if the file cannot be read.
+	 */
+	static bool copy(const std::string& file, const std::string& path, size_t& size);
+
+	explicit StagingCache(size_t capacity);
+
+	StagingCache(const StagingCache&) = delete;
+	StagingCache& operator=(const StagingCache&) = delete;
+
+	~StagingCache();
+
+	// Pins file and schedules its copy unless it is staged or being staged already
+	void prefetch(const std::string& file);
+
+	// Unpins file, returns the number of files evicted as a consequence
+	size_t release(const std::string& file);
+
+	bool staged(const std::string& file) const;
+
+	size_t used() const;
+
+	// Stops the staging thread and removes every staged file
+	void clear();
+
+private:
+	static std::string path(const ObjectID& id);
+
+	void run();
+
+	void remove(const ObjectStore::ObjectList& ids);
+
+	mutable std::mutex 		m_mutex;
+	std::condition_variable m_cond;
+
+	// files waiting for the staging thread, and their keys
+	std::deque<std::string> m_queue;
+	std::set<ObjectID> 		m_pending;
+
+	ObjectStore 			m_index;
+	bool 					m_stop;
+
+	std::thread 			m_thr;
+};
+
+/**
+ * Input file argument of a typed kernel: the file is declared at spawn and staged on the
+ * node running the task, the kernel receives the path of the staged copy
+ */
+struct InputFile {
+	std::string path;
+};
+
+inline void pack(std::string& buf, const InputFile& file) { detail::pack(buf, file.path); }
+
+inline void unpack(const char*& ptr, InputFile& file) {
+	detail::unpack(ptr, file.path);
+	file.path = StagingCache::lookup(file.path);
+}
+
+} // end namespace mpits
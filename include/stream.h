@@ -0,0 +1,137 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "kernel.h"
+#include "object_store.h"
+
+namespace mpits {
+
+/**
+ * Handle of a stream, passed to the producer and to the consumer task as a kernel
+ * argument. The capacity (bytes) of the ring is a power of two.
+ */
+struct StreamRef {
+	ObjectID 		id;
+	unsigned long 	capacity;
+};
+
+/**
+ * Endpoint of a stream between two tasks running at the same time on the same node. The
+ * producer writes chunks into a bounded ring in shared memory and the consumer reads them
+ * as they arrive; writes block while the ring is full (backpressure) and reads while it is
+ * empty. Both endpoints busy-wait, backing off to short sleeps, on the rank which runs
+ * them: the scheduler starts the tasks at the two ends together, on the node of the ring.
+ *
+ * The stream ends when the writer is closed, closing the reader makes the pending and
+ * future writes fail. The reader removes the ring once it goes away, the rings left 
+ * behind are removed with the object store of the node.
+ */
+struct Stream {
+
+	enum Endpoint { READER, WRITER };
+
+	/**
+	 * Creates, on the node with the given index, a ring of at least capacity bytes (a 
+	 * chunk and its 8 bytes header must fit in it). Returns the null handle (id 0) on 
+	 * failure.
+	 */
+	static StreamRef create(size_t capacity, unsigned node=0);
+
+	// Name of the shared memory object holding the ring of the stream id
+	static std::string name(const ObjectID& id);
+
+	Stream(const StreamRef& ref, const Endpoint& endpoint);
+
+	Stream(const Stream&) = delete;
+	Stream& operator=(const Stream&) = delete;
+
+	~Stream();
+
+	// False if the ring could not be mapped (it was removed or lives on another node)
+	bool valid() const { return m_header != nullptr; }
+
+	/**
+	 * Appends a chunk to the stream, waiting for the reader to make room. Returns false
+	 * if the reader is gone or if the chunk can never fit in the ring.
+	 */
+	bool write(const void* data, size_t size);
+
+	// As write but returns false, without waiting, if the ring has no room for the chunk
+	bool try_write(const void* data, size_t size);
+
+	/**
+	 * Reads the next chunk, waiting for the writer. Returns false at the end of the
+	 * stream.
+	 */
+	bool read(std::string& chunk);
+
+	// As read but returns false, without waiting, if no chunk is available
+	bool try_read(std::string& chunk);
+
+	// True once the writer closed the stream and every chunk was read
+	bool eof() const;
+
+	void close();
+
+	struct Header;
+
+private:
+	StreamRef 		m_ref;
+	Endpoint 		m_endpoint;
+	Header* 		m_header;
+	char* 			m_ring;
+	bool 			m_closed;
+
+	void copy_in(uint64_t pos, const void* data, size_t size);
+	void copy_out(uint64_t pos, void* data, size_t size) const;
+};
+
+/**
+ * Typed endpoints, values are packed with the codec of the kernel arguments
+ */
+template <typename T>
+struct StreamWriter {
+
+	explicit StreamWriter(const StreamRef& ref) : m_stream(ref, Stream::WRITER) { }
+
+	bool valid() const { return m_stream.valid(); }
+
+	bool push(const T& value) {
+		m_buf.clear();
+		detail::pack(m_buf, value);
+		return m_stream.write(m_buf.data(), m_buf.size());
+	}
+
+	void close() { m_stream.close(); }
+
+private:
+	Stream 			m_stream;
+	std::string 	m_buf;
+};
+
+template <typename T>
+struct StreamReader {
+
+	explicit StreamReader(const StreamRef& ref) : m_stream(ref, Stream::READER) { }
+
+	bool valid() const { return m_stream.valid(); }
+
+	// Returns false at the end of the stream
+	bool pop(T& value) {
+		if (!m_stream.read(m_buf)) { return false; }
+
+		const char* ptr = m_buf.data();
+		detail::unpack(ptr, value);
+		return true;
+	}
+
+	void close() { m_stream.close(); }
+
+private:
+	Stream 			m_stream;
+	std::string 	m_buf;
+};
+
+} // end namespace mpits
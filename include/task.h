@@ -2,9 +2,13 @@
 
 #include <mpi.h>
 
+#include <chrono>
 #include <memory>
 #include <vector>
 
+#include "kernel_registry.h"
+#include "object_store.h"
+
 namespace mpits {
 
 
@@ -14,36 +18,93 @@ struct Task {
 
 	typedef unsigned long TaskID;
 
+	typedef std::vector<TaskID> TaskIDList;
+
+	// Objects read by the task, declared at spawn
+	typedef std::vector<ObjectRef> InputList;
+
+	// Paths of the input files of the task, staged on the node running it 
+	typedef std::vector<std::string> FileList;
+
+	/**
+	 * Task ids are globally unique: the highest bits store the rank (within the 
+	 * schedulers communicator) of the scheduler which created the task. 
+	 */
+	static const unsigned NODE_BITS = 16;
+	static const unsigned COUNTER_BITS = sizeof(TaskID)*8 - NODE_BITS;
+
+	static TaskID make_tid(unsigned node, const TaskID& counter) {
+		return (TaskID(node) << COUNTER_BITS) | counter;
+	}
+
+	static unsigned owner(const TaskID& tid) { return tid >> COUNTER_BITS; }
 
 	const TaskID& taskID() const { return m_tid; }
 
-	Task(const TaskID& tid, const std::string& kernel, unsigned min, unsigned max) 
+	Task(const TaskID& 						tid, 
+		 const KernelRegistry::KernelID& 	kernel, 
+		 unsigned 				min, 
+		 unsigned 				max, 
+		 const std::string& 	args=std::string(),
+		 const InputList& 		inputs=InputList(),
+		 const FileList& 		files=FileList()) 
 		: m_tid(tid), 
 		  m_kernel(kernel), 
 		  m_min(min), 
-		  m_max(max) { }
+		  m_max(max),
+		  m_args(args),
+		  m_inputs(inputs),
+		  m_files(files) { }
 
 	const Task::TaskID& tid() const { return m_tid; }
 
-	const std::string& kernel() const { return m_kernel; }
+	// Id of the kernel in the registry, validated when the task is created 
+	const KernelRegistry::KernelID& kernel() const { return m_kernel; }
 
 	unsigned min() const { return m_min; }
 
 	unsigned max() const { return m_max; }
 
+	// Packed arguments of the kernel, encoded as a Payload 
+	const std::string& args() const { return m_args; }
+
+	const InputList& inputs() const { return m_inputs; }
+
+	const FileList& files() const { return m_files; }
+
 	virtual ~Task() { }
 
 private:
 
-	TaskID 			m_tid;
-	std::string 	m_kernel;
+	TaskID 						m_tid;
+	KernelRegistry::KernelID 	m_kernel;
 
 	unsigned 		m_min;
 	unsigned 		m_max;
+
+	std::string 	m_args;
+	InputList 		m_inputs;
+	FileList 		m_files;
 };
 
 typedef std::shared_ptr<Task> TaskPtr;
 
+/**
+ * Contiguous range of task ids [first, first+count), returned by spawn_n 
+ */
+struct TaskRange {
+	Task::TaskID 	first;
+	unsigned 		count;
+
+	Task::TaskID operator[](unsigned idx) const { return first+idx; }
+
+	Task::TaskIDList tids() const {
+		Task::TaskIDList ret(count);
+		for (unsigned idx=0; idx<count; ++idx) { ret[idx] = first+idx; }
+		return ret;
+	}
+};
+
 
 struct RemoteTask: public Task {
 
@@ -55,11 +116,30 @@ struct LocalTask: public Task {
 	
 	typedef std::vector<int> RankList;
 
-	LocalTask(const Task& tid, const RankList& ranks) :
-		Task(tid), m_ranks(ranks) { }
+	LocalTask(const Task& tid, const RankList& ranks, const std::vector<int>& peers=std::vector<int>()) :
+		Task(tid), 
+		m_ranks(ranks), 
+		m_peers(peers), 
+		m_wakeup(0), 
+		m_successor(0), 
+		m_start(std::chrono::high_resolution_clock::now()) { }
 
 	const RankList& ranks() const { return m_ranks; }
 
+	// Schedulers hosting the remaining ranks of a task which spans multiple nodes
+	const std::vector<int>& peers() const { return m_peers; }
+
+	const std::chrono::high_resolution_clock::time_point& start_time() const { return m_start; }
+
+	// The task is sent to its ranks, for tasks pre-assigned before their ranks were free
+	void restart() { m_start = std::chrono::high_resolution_clock::now(); }
+
+	// The task whose completion woke up this task (when suspended)
+	Task::TaskID& wakeup() { return m_wakeup; }
+
+	// Task pre-assigned to the ranks of this task while it was finishing, 0 if none 
+	Task::TaskID& successor() { return m_successor; }
+
 	Task::Status& status() { return m_ts; }
 	const Task::Status& status() const { return m_ts; }
 
@@ -68,6 +148,12 @@ private:
 	RankList m_ranks;
 	Task::Status m_ts;
 
+	std::vector<int> m_peers;
+	Task::TaskID 	 m_wakeup;
+	Task::TaskID 	 m_successor;
+
+	std::chrono::high_resolution_clock::time_point m_start;
+
 };
 
 typedef std::shared_ptr<LocalTask> LocalTaskPtr;
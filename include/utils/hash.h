@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace mpits {
+namespace utils {
+
+	/**
+	 * 64 bit FNV-1a hash, stable across processes and runs (unlike std::hash) so that
+	 * different ranks derive the same key from the same bytes
+	 */
+	inline uint64_t fnv1a(const void* data, size_t size, uint64_t hash=14695981039346656037ull) {
+		const unsigned char* ptr = static_cast<const unsigned char*>(data);
+		for (size_t idx=0; idx<size; ++idx) {
+			hash ^= ptr[idx];
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	inline uint64_t fnv1a(const std::string& str, uint64_t hash=14695981039346656037ull) {
+		return fnv1a(str.data(), str.size(), hash);
+	}
+
+} // end namespace utils
+} // end namespace mpits
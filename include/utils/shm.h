@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstring>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace mpits {
+namespace utils {
+
+	/**
+	 * Creates the POSIX shared memory object name holding a copy of the size bytes at
+	 * data (zeros if data is null). Returns false if the object exists already or cannot
+	 * be created.
+	 */
+	inline bool shm_create(const std::string& name, const void* data, size_t size) {
+
+		int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+		if (fd < 0) { return false; }
+
+		void* addr = MAP_FAILED;
+		if (ftruncate(fd, size) == 0) {
+			addr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		}
+		close(fd);
+
+		if (addr == MAP_FAILED) {
+			shm_unlink(name.c_str());
+			return false;
+		}
+
+		if (data) { std::memcpy(addr, data, size); }
+		munmap(addr, size);
+		return true;
+	}
+
+	// Maps the first size bytes of the object (read-only by default), returns nullptr on failure
+	inline void* shm_map(const std::string& name, size_t size, bool writable=false) {
+
+		int fd = shm_open(name.c_str(), writable ? O_RDWR : O_RDONLY, 0);
+		if (fd < 0) { return nullptr; }
+
+		void* addr = mmap(nullptr, size, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+		close(fd);
+
+		return addr == MAP_FAILED ? nullptr : addr;
+	}
+
+	// Removes the name of the object, the memory is freed once the last mapping goes away
+	inline void shm_remove(const std::string& name) { shm_unlink(name.c_str()); }
+
+} // end namespace utils
+} // end namespace mpits
@@ -9,17 +9,49 @@ namespace mpits {
 
 struct Worker : public Role {
 
-	Worker(const MPI_Comm& node_comm) : 
-		Role(Role::RT_WORKER, node_comm), 
-		m_pid(getpid()) { }
+	Worker(const MPI_Comm& node_comm, int node) : 
+		Role(Role::RT_WORKER, node_comm, node), 
+		m_pid(getpid()),
+		m_inline(getenv("MPITS_INLINE_TASKS") != nullptr),
+		m_pipelined(getenv("MPITS_PIPELINED_LAUNCH") != nullptr),
+		m_reclaim_after(getenv("MPITS_RECLAIM_AFTER") ? atoi(getenv("MPITS_RECLAIM_AFTER")) : -1),
+		m_lease_first(0),
+		m_lease_req(MPI_REQUEST_NULL) 
+	{ 
+		m_lease.next = 0;
+		m_lease.left = 0;
+	}
 
 	const pid_t& pid() const { return m_pid; }
 
 	void do_work();
 
-	Task::TaskID spawn(const std::string& kernel, unsigned min, unsigned max);
+	Task::TaskID spawn(const KernelRegistry::KernelID& 	kernel, 
+					   unsigned 				min, 
+					   unsigned 				max, 
+					   const Task::TaskIDList& 	deps, 
+					   const std::string& 		args,
+					   const Task::InputList& 	inputs,
+					   const Task::FileList& 	files);
 
-	void wait_for(const Task::TaskID& tid);
+	TaskRange spawn_n(const KernelRegistry::KernelID& kernel, unsigned count, unsigned min, unsigned max);
+
+	void set_result(const std::string& result);
+
+	// Collective over the group of the running task
+	std::string result(const Task::TaskID& tid);
+
+	void store_insert(const ObjectRef& ref);
+
+	void store_acquire(const ObjectID& id);
+
+	void store_release(const ObjectID& id);
+
+	void stream_insert(const ObjectID& id);
+
+	void wait_all(const Task::TaskIDList& tids) { wait(tids, false); }
+
+	Task::TaskID wait_any(const Task::TaskIDList& tids) { return wait(tids, true); }
 
 	virtual Task::TaskID get_tid();
 
@@ -27,8 +59,58 @@ struct Worker : public Role {
 
 private:
 
+	Task::TaskID wait(const Task::TaskIDList& tids, bool any);
+
+	// Takes the next tid from the leased block, refilling it in background 
+	Task::TaskID next_tid();
+
+	void request_lease();
+
+	// Asks the scheduler for the (encoded) result of a completed task
+	std::string fetch_result(const Task::TaskID& tid);
+
+	// Lets the scheduler account for the tasks executed inline since the last report 
+	void report_inlined();
+
+	// Releases the unused stack pages of the tasks suspended for too long 
+	void reclaim_stacks();
+
 	pid_t 	m_pid;
 
+	/**
+	 * Single-rank children spawned from a kernel are executed by the spawning worker 
+	 * (when it waits or finalizes) instead of being scheduled, enabled by setting 
+	 * MPITS_INLINE_TASKS 
+	 */
+	bool 			m_inline;
+	Task::TaskIDList m_inlined;
+
+	/**
+	 * Pipelined launch, enabled by setting MPITS_PIPELINED_LAUNCH: the leader lets the 
+	 * scheduler know when a task reaches its end, so that the next task can be assigned to 
+	 * its ranks before they go idle. Idle workers poll for a while before going to sleep.
+	 */
+	bool 			m_pipelined;
+
+	/**
+	 * Milliseconds after which the stack pages below the frames of a suspended task 
+	 * are returned to the system, set by MPITS_RECLAIM_AFTER (disabled when negative)
+	 */
+	int 			m_reclaim_after;
+
+	/**
+	 * Block of tids leased from the scheduler, the next block is requested once half 
+	 * of the current one is consumed
+	 */
+	struct TidLease {
+		Task::TaskID 	next;
+		unsigned 		left;
+	};
+
+	TidLease 		m_lease;
+	Task::TaskID 	m_lease_first;
+	MPI_Request 	m_lease_req;
+
 };
 
 } // end namespace mpits 
@@ -5,16 +5,45 @@
 #include <vector>
 
 #include <ctime>
+#include <chrono>
 
 #include "mpits.h"
+#include "kernel_registry.h"
 
 #include "utils/string.h"
 #include "utils/logging.h"
 
 extern "C" { 
 	void kernel_1(intptr_t);
+	void busy_kernel(intptr_t);
+	void fanout_kernel(intptr_t);
+	void leaf_kernel(intptr_t);
+
+	// name, entry point, default group size [min,max], cost hint (usecs) and flags
+	mpits::KernelDesc mpits_kernels[] = {
+		{ "kernel_1", 		kernel_1, 		2, 2, 0, 		0 },
+		{ "busy_kernel", 	busy_kernel, 	1, 1, 20000, 	0 },
+		{ "fanout_kernel", 	fanout_kernel, 	1, 1, 0, 		0 },
+		{ "leaf_kernel", 	leaf_kernel, 	1, 1, 1, 		mpits::KernelDesc::BUNDLE },
+		{ nullptr, nullptr, 0, 0, 0, 0 }
+	};
 }
 
+/**
+ * Typed kernel, prints the sum of the values it receives and returns it 
+ */
+void sum_kernel(MPI_Comm comm, std::vector<int> values) {
+
+	int sum = 0;
+	for (int v : values) { sum += v; }
+
+	LOG(INFO) << "Sum of " << mpits::utils::join(values, "+") << " = " << sum;
+
+	mpits::return_value(sum);
+}
+
+MPITS_KERNEL(sum_kernel, 1, 1, 0);
+
 void kernel_1(intptr_t comm_ptr) {
 
 	MPI_Comm comm = *(MPI_Comm*)comm_ptr;
@@ -38,11 +67,15 @@ void kernel_1(intptr_t comm_ptr) {
 	std::vector<int> ret(v.size());
 	MPI_Reduce(&v.front(), &ret.front(), comm_size, MPI_INT, MPI_SUM, 0, comm);
 
+	mpits::Task::TaskID tid = 0;
 	if (rank==0) {
 		std::cout << mpits::utils::join(ret, "-") << std::endl;
+		tid = mpits::spawn(&sum_kernel, 1, 1, ret);
 	}
+	MPI_Bcast(&tid, 1, MPI_UNSIGNED_LONG, 0, comm);
 	
-	mpits::wait_for(5);
+	int sum = mpits::wait_for<int>(tid);
+	LOG(INFO) << "Task " << tid << " returned " << sum;
 
 	// mpits::Task::TaskID id = mpits::spawn("kernel_1", 2, 2);
 	
@@ -50,3 +83,31 @@ void kernel_1(intptr_t comm_ptr) {
 
 	mpits::finalize();
 }
+
+/**
+ * Keeps every rank of the group busy for 20 milliseconds, used by the benchmarks 
+ */
+void busy_kernel(intptr_t comm_ptr) {
+
+	auto end = std::chrono::high_resolution_clock::now() + std::chrono::milliseconds(20);
+	while (std::chrono::high_resolution_clock::now() < end) ;
+
+	mpits::finalize();
+}
+
+/**
+ * Spawns 1000 single-rank children doing no work and waits for them, used to measure 
+ * the throughput of tiny tasks 
+ */
+void fanout_kernel(intptr_t comm_ptr) {
+
+	mpits::Task::TaskIDList tids;
+	for (int i=0; i<1000; ++i) { tids.push_back( mpits::spawn("leaf_kernel", 1, 1) ); }
+
+	mpits::wait_all(tids);
+	mpits::finalize();
+}
+
+void leaf_kernel(intptr_t comm_ptr) {
+	mpits::finalize();
+}
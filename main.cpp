@@ -17,15 +17,9 @@ int main(int argc, char* argv[]) {
 
 	LOG(INFO) << "MPI Task System";
 
-	for (int i=0; i<n; ++i) {
-		auto tid1 = mpits::spawn("kernel_1", 2, 2);
-	}
+	auto tids = mpits::spawn_n("kernel_1", n, 2, 2);
 
-
-	mpits::wait_for(4);
-	mpits::wait_for(1);
-	mpits::wait_for(2);
-	mpits::wait_for(3);
+	mpits::wait_all(tids.tids());
 
 	mpits::finalize();
 }
@@ -1,8 +1,10 @@
 
 #include "comm/init.h"
 
+#include <map>
 #include <set>
 
+#include <sched.h>
 #include <mpi.h>
 #include "utils/logging.h"
 #include "utils/string.h"
@@ -36,8 +38,21 @@ namespace mpits {
 		delete[] hostname;
 
 		std::set<std::string> hosts;
+		std::map<std::string, int> first_rank;
 		for(size_t p=0; p<static_cast<size_t>(nprocs); ++p) {
-			hosts.insert( std::string(&other_hostname[p*(MAX_HOSTNAME_LENGTH+1)]) );
+			std::string cur(&other_hostname[p*(MAX_HOSTNAME_LENGTH+1)]);
+			hosts.insert( cur );
+			first_rank.insert( {cur, p} );
+		}
+
+		/*
+		 * The scheduler of a node is its lowest world rank and the schedulers communicator 
+		 * keeps the world order, therefore every process can compute the rank of its 
+		 * scheduler (the index of the node) 
+		 */
+		int node = 0;
+		for (const auto& cur : first_rank) {
+			if (cur.second < first_rank[host]) { ++node; }
 		}
 	
 		// declare communicators
@@ -67,25 +82,32 @@ namespace mpits {
 
 		LOG(DEBUG) << "\\@ Initialization completed!";
 
-		int mypid = getpid();
+		/* 
+		 * Each process sends its pid and the cpu it is running on, the latter is used 
+		 * by the scheduler to detect the socket/NUMA domain of the ranks
+		 */
+		int myinfo[2] = { getpid(), sched_getcpu() };
 		if (node_comm_rank==0) {
-			std::vector<int> node_pids(node_comm_size);
+			std::vector<int> node_info(2*node_comm_size);
 
-			MPI_Gather(&mypid, 1, MPI_INT, 
-					   &node_pids.front(), 1, MPI_INT, 
+			MPI_Gather(myinfo, 2, MPI_INT, 
+					   &node_info.front(), 2, MPI_INT, 
 					   0, node_comm);
 			
 			Scheduler::Pids pids(node_comm_size);
-			for(int i=1;i<node_comm_size;++i) 
-				pids[i-1] = { i, node_pids[i] };
+			std::vector<int> cpus(node_comm_size);
+			for(int i=0;i<node_comm_size;++i) {
+				if (i>0) { pids[i-1] = { i, node_info[2*i] }; }
+				cpus[i] = node_info[2*i+1];
+			}
 
 			return std::move( std::unique_ptr<Scheduler>( 
-						new Scheduler(node_comm, sched_comm, std::move(pids)) ) 
+						new Scheduler(node_comm, sched_comm, node, std::move(pids), cpus) ) 
 					);
 		}
 
-		MPI_Gather(&mypid, 1, MPI_INT, NULL, 0, MPI_INT, 0, node_comm);
-		return std::move( std::unique_ptr<Worker>( new Worker(node_comm) ) );
+		MPI_Gather(myinfo, 2, MPI_INT, NULL, 0, MPI_INT, 0, node_comm);
+		return std::move( std::unique_ptr<Worker>( new Worker(node_comm, node) ) );
 	}
 
 }
@@ -0,0 +1,93 @@
+
+#include "kernel_registry.h"
+
+#include "utils/logging.h"
+
+#include <cstdlib>
+#include <sstream>
+
+#include <dlfcn.h>
+
+namespace mpits {
+
+namespace {
+
+	typedef std::vector<std::pair<KernelDesc, const void*>> StaticKernels;
+
+	// kernels registered at static initialization time and not yet loaded
+	StaticKernels& static_kernels() {
+		static StaticKernels kernels;
+		return kernels;
+	}
+
+} // end anonymous namespace
+
+const KernelRegistry::KernelID KernelRegistry::INVALID;
+
+void KernelRegistry::add_static(const KernelDesc& desc, const void* fn) {
+	static_kernels().push_back( {desc, fn} );
+}
+
+bool KernelRegistry::add(const KernelDesc& desc, const std::string& origin) {
+	if (!m_ids.insert( {desc.name, m_kernels.size()} ).second) {
+		LOG(WARNING) << "Kernel '" << desc.name << "' of " << origin << " already registered";
+		return false;
+	}
+	m_kernels.push_back(desc);
+	return true;
+}
+
+void KernelRegistry::load_static() {
+	for (const auto& cur : static_kernels()) {
+		if (add(cur.first, "static registration")) { 
+			m_fn_ids.insert( {cur.second, KernelID(m_kernels.size()-1)} ); 
+		}
+	}
+	static_kernels().clear();
+}
+
+KernelRegistry::~KernelRegistry() {
+	for (void* handle : m_handles) { dlclose(handle); }
+}
+
+std::vector<std::string> KernelRegistry::libraries() {
+
+	const char* env = getenv("MPITS_KERNELS");
+	std::istringstream ss(env ? env : "./libkernels.so");
+
+	std::vector<std::string> libs;
+	std::string lib;
+	while (std::getline(ss, lib, ':')) { 
+		if (!lib.empty()) { libs.push_back(lib); }
+	}
+	return libs;
+}
+
+void KernelRegistry::load(const std::vector<std::string>& libs) {
+
+	// typed kernels of the executable 
+	load_static();
+
+	for (const std::string& lib : libs) {
+
+		LOG(DEBUG) << "Opening " << lib << "...";
+		void* handle = dlopen(lib.c_str(), RTLD_NOW);
+		if (!handle) {
+			LOG(ERROR) << "Cannot open library: " << dlerror();
+			::exit(1);
+		}
+		m_handles.push_back(handle);
+
+		// typed kernels registered while the library was initialized
+		load_static();
+
+		auto* table = static_cast<const KernelDesc*>(dlsym(handle, KERNEL_TABLE));
+		if (!table) { continue; }
+
+		for (; table->name; ++table) { add(*table, lib); }
+	}
+
+	LOG(DEBUG) << "Registered " << m_kernels.size() << " kernel(s)";
+}
+
+} // end namespace mpits
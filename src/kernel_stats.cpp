@@ -0,0 +1,39 @@
+#include "kernel_stats.h"
+
+#include <algorithm>
+
+// Weight of the last run in the average runtime of a kernel 
+#define RUNTIME_WEIGHT 0.25
+
+// Runs of a kernel averaged before its runtime is trusted to size bundles 
+#define MIN_BUNDLE_RUNS 8u
+
+namespace mpits {
+
+void KernelStats::record(const KernelRegistry::KernelID& kernel, double runtime) {
+
+	Entry& entry = m_entries[kernel];
+	entry.runtime = entry.runs ? (1-RUNTIME_WEIGHT)*entry.runtime + RUNTIME_WEIGHT*runtime : runtime;
+	++entry.runs;
+}
+
+unsigned KernelStats::bundle_size(const KernelRegistry::KernelID& kernel, double target, unsigned max) const {
+
+	auto fit = m_entries.find(kernel);
+	if (fit == m_entries.end() || fit->second.runs < MIN_BUNDLE_RUNS) { return 1; }
+
+	if (fit->second.runtime * max <= target) { return std::max(max, 1u); }
+	return std::max(1u, static_cast<unsigned>(target / fit->second.runtime));
+}
+
+unsigned KernelStats::runs(const KernelRegistry::KernelID& kernel) const {
+	auto fit = m_entries.find(kernel);
+	return fit == m_entries.end() ? 0 : fit->second.runs;
+}
+
+double KernelStats::runtime(const KernelRegistry::KernelID& kernel) const {
+	auto fit = m_entries.find(kernel);
+	return fit == m_entries.end() ? 0 : fit->second.runtime;
+}
+
+} // end namespace mpits
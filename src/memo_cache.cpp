@@ -0,0 +1,39 @@
+#include "memo_cache.h"
+
+#include "utils/hash.h"
+
+namespace mpits {
+
+MemoCache::Key MemoCache::key(const Call& call) {
+	return utils::fnv1a(call.args, utils::fnv1a(&call.kernel, sizeof(call.kernel)));
+}
+
+bool MemoCache::lookup(const Call& call, std::string& result) {
+
+	auto fit = m_entries.find(call);
+	if (fit == m_entries.end()) { return false; }
+
+	m_lru.splice(m_lru.begin(), m_lru, fit->second.lru);
+	result = fit->second.result;
+	++m_hits;
+	return true;
+}
+
+void MemoCache::insert(const Call& call, const std::string& result) {
+
+	size_t size = call.args.size() + result.size();
+	if (size > m_capacity || m_entries.count(call)) { return; }
+
+	auto it = m_entries.insert( {call, Entry{result, LruList::iterator()}} ).first;
+	it->second.lru = m_lru.insert(m_lru.begin(), &it->first);
+	m_used += size;
+
+	while (m_used > m_capacity) {
+		auto fit = m_entries.find(*m_lru.back());
+		m_used -= fit->first.args.size() + fit->second.result.size();
+		m_lru.pop_back();
+		m_entries.erase(fit);
+	}
+}
+
+} // end namespace mpits
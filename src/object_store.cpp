@@ -0,0 +1,180 @@
+#include "object_store.h"
+
+#include "utils/shm.h"
+
+#include <atomic>
+#include <cassert>
+#include <sstream>
+
+namespace mpits {
+
+std::string ObjectStore::name(const ObjectID& id) {
+	std::ostringstream ss;
+	ss << "/mpits.obj." << std::hex << id;
+	return ss.str();
+}
+
+ObjectID ObjectStore::next_id(unsigned node) {
+	static std::atomic<unsigned long> counter(0);
+
+	// pids are unique within the node
+	return (static_cast<ObjectID>(node) << 48) | 
+		   ((static_cast<ObjectID>(getpid()) & 0x3fffff) << 26) | (++counter & 0x3ffffff);
+}
+
+ObjectStore::ObjectList ObjectStore::insert(const ObjectID& id, size_t size, int producer) {
+
+	Entry& entry = m_entries[id];
+	assert(!entry.stored && "Object inserted twice");
+
+	entry.size = size;
+	entry.producer = producer;
+	entry.stored = true;
+	entry.lru = m_lru.insert(m_lru.begin(), id);
+	m_used += size;
+
+	// the new object is kept even if the mapped ones fill the store
+	return evict(id);
+}
+
+void ObjectStore::acquire(const ObjectID& id) {
+
+	auto fit = m_entries.find(id);
+	if (fit == m_entries.end()) {
+		Entry entry = { 0, 1, -1, false, m_lru.end() };
+		m_entries.insert( {id, entry} );
+		return;
+	}
+
+	Entry& entry = fit->second;
+	++entry.refs;
+
+	if (entry.stored) { m_lru.splice(m_lru.begin(), m_lru, entry.lru); }
+}
+
+ObjectStore::ObjectList ObjectStore::release(const ObjectID& id) {
+
+	auto fit = m_entries.find(id);
+	if (fit == m_entries.end() || fit->second.refs == 0) { return ObjectList(); }
+
+	Entry& entry = fit->second;
+	if (--entry.refs > 0) { return ObjectList(); }
+
+	if (!entry.stored) {
+		m_entries.erase(fit);
+		return ObjectList();
+	}
+	return evict();
+}
+
+ObjectStore::ObjectList ObjectStore::evict(const ObjectID& keep) {
+
+	ObjectList evicted;
+
+	// least recently used first, mapped objects are skipped
+	for (auto it = m_lru.end(); m_used > m_capacity && it != m_lru.begin(); ) {
+		--it;
+
+		auto fit = m_entries.find(*it);
+		assert(fit != m_entries.end());
+		if (fit->second.refs || *it == keep) { continue; }
+
+		evicted.push_back(*it);
+		m_used -= fit->second.size;
+		m_entries.erase(fit);
+		it = m_lru.erase(it);
+	}
+	return evicted;
+}
+
+ObjectStore::ObjectList ObjectStore::clear() {
+	ObjectList stored(m_lru.begin(), m_lru.end());
+
+	m_entries.clear();
+	m_lru.clear();
+	m_used = 0;
+	return stored;
+}
+
+int ObjectStore::producer(const ObjectID& id) const {
+	auto sit = m_streams.find(id);
+	if (sit != m_streams.end()) { return sit->second.producer; }
+
+	auto fit = m_entries.find(id);
+	return fit != m_entries.end() && fit->second.stored ? fit->second.producer : -1;
+}
+
+bool ObjectStore::contains(const ObjectID& id) const {
+	auto fit = m_entries.find(id);
+	return fit != m_entries.end() && fit->second.stored;
+}
+
+void ObjectStore::insert_stream(const ObjectID& id, int producer) {
+	StreamEntry entry = { producer, false };
+	m_streams.insert( {id, entry} );
+}
+
+bool ObjectStore::is_stream(const ObjectID& id) const {
+	return m_streams.find(id) != m_streams.end();
+}
+
+void ObjectStore::start_stream(const ObjectID& id) {
+	auto fit = m_streams.find(id);
+	if (fit != m_streams.end()) { fit->second.started = true; }
+}
+
+bool ObjectStore::stream_started(const ObjectID& id) const {
+	auto fit = m_streams.find(id);
+	return fit != m_streams.end() && fit->second.started;
+}
+
+ObjectStore::ObjectList ObjectStore::clear_streams() {
+	ObjectList streams;
+	for (const auto& cur : m_streams) { streams.push_back(cur.first); }
+
+	m_streams.clear();
+	return streams;
+}
+
+ObjectView::ObjectView(const ObjectRef& ref, const ReleaseCallback& release) :
+	m_ref(ref), m_addr(nullptr), m_valid(true), m_release(release)
+{
+	if (ref.size == 0) { return; }
+
+	m_addr = utils::shm_map(ObjectStore::name(ref.id), ref.size);
+	m_valid = m_addr != nullptr;
+}
+
+ObjectView::ObjectView(ObjectView&& other) :
+	m_ref(other.m_ref), m_addr(other.m_addr), m_valid(other.m_valid), m_release(std::move(other.m_release))
+{
+	other.m_ref = ObjectRef{0, 0};
+	other.m_addr = nullptr;
+	other.m_release = nullptr;
+}
+
+ObjectView& ObjectView::operator=(ObjectView&& other) {
+	if (this != &other) {
+		reset();
+		m_ref = other.m_ref;
+		m_addr = other.m_addr;
+		m_valid = other.m_valid;
+		m_release = std::move(other.m_release);
+
+		other.m_ref = ObjectRef{0, 0};
+		other.m_addr = nullptr;
+		other.m_release = nullptr;
+	}
+	return *this;
+}
+
+void ObjectView::reset() {
+	if (m_addr) { munmap(m_addr, m_ref.size); }
+	if (m_ref.id && m_release) { m_release(m_ref.id); }
+
+	m_ref = ObjectRef{0, 0};
+	m_addr = nullptr;
+	m_release = nullptr;
+}
+
+} // end namespace mpits
@@ -0,0 +1,136 @@
+#include "payload.h"
+
+#include "utils/logging.h"
+#include "utils/shm.h"
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+
+// Size (in bytes) above which buffers go through shared memory when MPITS_SHM_THRESHOLD is not set
+#define DEFAULT_SHM_THRESHOLD (64u*1024u)
+
+namespace mpits {
+
+namespace {
+
+	const size_t HEADER_SIZE = 1 + sizeof(uint64_t);
+
+	// Names are unique within the node: the pid of the creator and a per-process counter
+	std::string next_name() {
+		static std::atomic<unsigned long> counter(0);
+
+		std::ostringstream ss;
+		ss << "/mpits." << getpid() << "." << counter++;
+		return ss.str();
+	}
+
+	std::string shared_name(const std::string& encoded) {
+		assert(Payload::is_shared(encoded) && encoded.size() > HEADER_SIZE);
+		return encoded.substr(HEADER_SIZE);
+	}
+
+} // end anonymous namespace
+
+const char Payload::INLINE;
+const char Payload::SHARED;
+
+size_t Payload::threshold() {
+	static size_t threshold = getenv("MPITS_SHM_THRESHOLD") ?
+			strtoul(getenv("MPITS_SHM_THRESHOLD"), nullptr, 10) : DEFAULT_SHM_THRESHOLD;
+	return threshold;
+}
+
+std::string Payload::encode(const std::string& data, size_t threshold) {
+
+	if (data.empty()) { return std::string(); }
+
+	if (data.size() > threshold) {
+		std::string name = next_name();
+		if (utils::shm_create(name, data.data(), data.size())) {
+			uint64_t size = data.size();
+
+			std::string encoded(1, SHARED);
+			encoded.append(reinterpret_cast<const char*>(&size), sizeof(size));
+			encoded.append(name);
+			return encoded;
+		}
+		LOG(WARNING) << "Cannot create shared memory object " << name << ", sending "
+					 << data.size() << " bytes inline";
+	}
+
+	std::string encoded;
+	encoded.reserve(data.size()+1);
+	encoded.push_back(INLINE);
+	encoded.append(data);
+	return encoded;
+}
+
+size_t Payload::size(const std::string& encoded) {
+	if (!is_shared(encoded)) { return encoded.empty() ? 0 : encoded.size()-1; }
+
+	uint64_t size;
+	std::memcpy(&size, encoded.data()+1, sizeof(size));
+	return size;
+}
+
+std::string Payload::make_inline(const std::string& encoded) {
+	if (!is_shared(encoded)) { return encoded; }
+
+	std::string data = Payload(encoded).str();
+	release(encoded);
+	return encode(data, data.size());
+}
+
+void Payload::release(const std::string& encoded) {
+	if (!is_shared(encoded)) { return; }
+	utils::shm_remove(shared_name(encoded));
+}
+
+Payload::Payload(const std::string& encoded) :
+	m_data(nullptr), m_size(size(encoded)), m_addr(nullptr), m_valid(true)
+{
+	if (!is_shared(encoded)) {
+		if (m_size) { m_data = encoded.data()+1; }
+		return;
+	}
+
+	void* addr = utils::shm_map(shared_name(encoded), m_size);
+	if (!addr) {
+		m_valid = false;
+		return;
+	}
+
+	m_addr = addr;
+	m_data = static_cast<const char*>(addr);
+}
+
+Payload::Payload(Payload&& other) :
+	m_data(other.m_data), m_size(other.m_size), m_addr(other.m_addr), m_valid(other.m_valid)
+{
+	other.m_addr = nullptr;
+}
+
+Payload& Payload::operator=(Payload&& other) {
+	if (this != &other) {
+		unmap();
+		m_data = other.m_data;
+		m_size = other.m_size;
+		m_addr = other.m_addr;
+		m_valid = other.m_valid;
+		other.m_addr = nullptr;
+	}
+	return *this;
+}
+
+Payload::~Payload() { unmap(); }
+
+void Payload::unmap() {
+	if (m_addr) { munmap(m_addr, m_size); }
+	m_addr = nullptr;
+}
+
+} // end namespace mpits
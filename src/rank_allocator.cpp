@@ -0,0 +1,289 @@
+
+#include "rank_allocator.h"
+
+#include "utils/logging.h"
+
+#include <cassert>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+#include <dirent.h>
+
+namespace mpits {
+
+namespace {
+
+	typedef RankAllocator::Word Word;
+	typedef RankAllocator::Mask Mask;
+
+	const unsigned WORD_BITS = RankAllocator::WORD_BITS;
+
+	/**
+	 * Returns the position of the first bit, starting from position 'from', which is set
+	 * (or cleared when set==false) in the mask. Returns 'size' if no such bit exists.
+	 */
+	unsigned find_next(const Mask& mask, unsigned from, bool set, unsigned size) {
+		if (from >= size) { return size; }
+
+		unsigned idx = from / WORD_BITS;
+		Word w = set ? mask[idx] : ~mask[idx];
+		w &= ~Word(0) << (from % WORD_BITS);
+
+		while (!w) {
+			if (++idx == mask.size()) { return size; }
+			w = set ? mask[idx] : ~mask[idx];
+		}
+
+		unsigned pos = idx*WORD_BITS + __builtin_ctzll(w);
+		return pos < size ? pos : size;
+	}
+
+	/**
+	 * Builds one mask per domain id, ranks with a negative domain id are left out
+	 */
+	std::vector<Mask> make_domains(const std::vector<int>& domain_of, size_t words) {
+		std::vector<Mask> domains;
+		for (unsigned rank=0; rank<domain_of.size(); ++rank) {
+			int dom = domain_of[rank];
+			if (dom < 0) { continue; }
+
+			if (static_cast<size_t>(dom) >= domains.size()) {
+				domains.resize(dom+1, Mask(words, 0));
+			}
+			domains[dom][rank/WORD_BITS] |= Word(1) << (rank%WORD_BITS);
+		}
+		return domains;
+	}
+
+	int read_socket(int cpu) {
+		std::ostringstream ss;
+		ss << "/sys/devices/system/cpu/cpu" << cpu << "/topology/physical_package_id";
+
+		std::ifstream in(ss.str());
+		int socket = -1;
+		if (!(in >> socket)) { return -1; }
+		return socket;
+	}
+
+	int read_numa_node(int cpu) {
+		std::ostringstream ss;
+		ss << "/sys/devices/system/cpu/cpu" << cpu;
+
+		DIR* dir = opendir(ss.str().c_str());
+		if (!dir) { return -1; }
+
+		// the cpu directory contains a 'nodeN' link to its NUMA node
+		int node = -1;
+		while (dirent* ent = readdir(dir)) {
+			int id;
+			char tail;
+			if (sscanf(ent->d_name, "node%d%c", &id, &tail) == 1) { node = id; break; }
+		}
+		closedir(dir);
+		return node;
+	}
+
+} // end anonymous namespace
+
+unsigned RankAllocator::count() const {
+	unsigned c = 0;
+	for (Word w : m_free) { c += __builtin_popcountll(w); }
+	return c;
+}
+
+void RankAllocator::release(const RankList& ranks) {
+	for (int rank : ranks) {
+		assert(!is_free(rank) && "Releasing a rank which is already free");
+		insert(rank);
+	}
+}
+
+void RankAllocator::take(unsigned n, const Mask& mask, RankList& ranks) {
+	for (size_t idx=0; idx<mask.size() && n; ++idx) {
+		Word w = mask[idx];
+		while (w && n) {
+			unsigned bit = __builtin_ctzll(w);
+			w &= w-1;
+			ranks.push_back(idx*WORD_BITS + bit);
+			m_free[idx] &= ~(Word(1) << bit);
+			--n;
+		}
+	}
+	assert(n == 0);
+}
+
+bool RankAllocator::acquire_domain(unsigned n, const std::vector<Mask>& domains, RankList& ranks) {
+
+	// Best fit: select the domain with the fewest free ranks which can host the task
+	const Mask* best = nullptr;
+	unsigned best_count = 0;
+	Mask avail(m_free.size());
+
+	for (const Mask& dom : domains) {
+		unsigned c = 0;
+		for (size_t idx=0; idx<dom.size(); ++idx) {
+			c += __builtin_popcountll(dom[idx] & m_free[idx]);
+		}
+
+		if (c >= n && (!best || c < best_count)) { best = &dom; best_count = c; }
+	}
+
+	if (!best) { return false; }
+
+	for (size_t idx=0; idx<avail.size(); ++idx) { avail[idx] = (*best)[idx] & m_free[idx]; }
+	take(n, avail, ranks);
+	return true;
+}
+
+bool RankAllocator::acquire_contiguous(unsigned n, RankList& ranks) {
+
+	unsigned pos = find_next(m_free, 0, true, m_size);
+	while (pos < m_size) {
+		unsigned end = find_next(m_free, pos, false, m_size);
+		if (end - pos >= n) {
+			for (unsigned rank=pos; rank<pos+n; ++rank) {
+				ranks.push_back(rank);
+				erase(rank);
+			}
+			return true;
+		}
+		pos = find_next(m_free, end, true, m_size);
+	}
+	return false;
+}
+
+bool RankAllocator::acquire(unsigned n, const Placement& p, RankList& ranks) {
+
+	if (n == 0) { return true; }
+
+	switch(p) {
+	case RP_NUMA:		return acquire_domain(n, m_numa_nodes, ranks);
+	case RP_SOCKET:		return acquire_domain(n, m_sockets, ranks);
+	case RP_CONTIGUOUS:	return acquire_contiguous(n, ranks);
+	case RP_ANY:
+		if (count() < n) { return false; }
+		take(n, m_free, ranks);
+		return true;
+	default:
+		assert(false && "Placement policy not supported");
+	}
+	return false;
+}
+
+RankAllocator::Mask RankAllocator::hide_pinned(unsigned n) {
+
+	Mask hidden(m_free.size());
+	unsigned others = 0;
+	bool any = false;
+	for (size_t idx=0; idx<m_free.size(); ++idx) {
+		hidden[idx] = m_free[idx] & m_pinned[idx];
+		others += __builtin_popcountll(m_free[idx] & ~m_pinned[idx]);
+		any = any || hidden[idx];
+	}
+
+	if (!any || others < n) { return Mask(); }
+
+	for (size_t idx=0; idx<m_free.size(); ++idx) { m_free[idx] &= ~hidden[idx]; }
+	return hidden;
+}
+
+void RankAllocator::restore(const Mask& hidden) {
+	for (size_t idx=0; idx<hidden.size(); ++idx) { m_free[idx] |= hidden[idx]; }
+}
+
+RankAllocator::RankList RankAllocator::acquire(unsigned n) {
+
+	Mask hidden = hide_pinned(n);
+	RankList ranks = acquire_free(n);
+	restore(hidden);
+	return ranks;
+}
+
+RankAllocator::RankList RankAllocator::acquire_free(unsigned n) {
+
+	RankList ranks;
+	ranks.reserve(n);
+
+	if (acquire(n, RP_NUMA, ranks) || acquire(n, RP_SOCKET, ranks) ||
+		acquire(n, RP_CONTIGUOUS, ranks) || acquire(n, RP_ANY, ranks))
+	{
+		return ranks;
+	}
+
+	assert(false && "Not enough free ranks");
+	return ranks;
+}
+
+RankAllocator::RankList RankAllocator::acquire_near(unsigned n, int rank) {
+
+	if (rank < 0 || static_cast<unsigned>(rank) >= m_size || n == 0) { return acquire(n); }
+
+	Mask hidden = hide_pinned(n);
+	RankList ranks = acquire_near_free(n, rank);
+	restore(hidden);
+	return ranks;
+}
+
+RankAllocator::RankList RankAllocator::acquire_near_free(unsigned n, int rank) {
+
+	RankList ranks;
+	ranks.reserve(n);
+
+	Word bit = Word(1) << (rank%WORD_BITS);
+	for (const std::vector<Mask>* domains : { &m_numa_nodes, &m_sockets }) {
+		for (const Mask& dom : *domains) {
+			if (!(dom[rank/WORD_BITS] & bit)) { continue; }
+
+			Mask avail(m_free.size());
+			unsigned c = 0;
+			for (size_t idx=0; idx<avail.size(); ++idx) { 
+				avail[idx] = dom[idx] & m_free[idx]; 
+				c += __builtin_popcountll(avail[idx]);
+			}
+			if (c < n) { break; }
+
+			// the rank itself leads the group
+			if (is_free(rank)) { 
+				erase(rank);
+				avail[rank/WORD_BITS] &= ~bit;
+				ranks.push_back(rank);
+			}
+			take(n-ranks.size(), avail, ranks);
+			return ranks;
+		}
+	}
+
+	if (is_free(rank)) { 
+		erase(rank); 
+		ranks.push_back(rank);
+	}
+
+	RankList rest = acquire_free(n-ranks.size());
+	ranks.insert(ranks.end(), rest.begin(), rest.end());
+	return ranks;
+}
+
+void RankAllocator::set_domains(const std::vector<int>& sockets, const std::vector<int>& numa_nodes) {
+	m_sockets = make_domains(sockets, m_free.size());
+	m_numa_nodes = make_domains(numa_nodes, m_free.size());
+}
+
+void RankAllocator::load_topology(const std::vector<int>& cpus) {
+
+	std::vector<int> sockets(cpus.size(), -1), numa_nodes(cpus.size(), -1);
+
+	for (size_t rank=0; rank<cpus.size(); ++rank) {
+		if (cpus[rank] < 0) { continue; }
+
+		sockets[rank] = read_socket(cpus[rank]);
+		numa_nodes[rank] = read_numa_node(cpus[rank]);
+	}
+
+	set_domains(sockets, numa_nodes);
+
+	LOG(DEBUG) << "Detected " << m_sockets.size() << " socket(s) and "
+			   << m_numa_nodes.size() << " NUMA node(s)";
+}
+
+} // end namespace mpits
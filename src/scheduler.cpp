@@ -1,157 +1,1429 @@
 #include "scheduler.h"
+#include "payload.h"
+#include "stream.h"
 
+#include "utils/shm.h"
 #include "utils/string.h"
 
+#define MIN_STEAL_DELAY 2ul
+#define MAX_STEAL_DELAY 200ul
+#define SPAN_RETRY_DELAY 50ul
+#define MAX_SPAN_RETRY_DELAY 2000ul
+
+// Interval (msecs) between the checks of the barriers closing the run 
+#define FINALIZE_POLL_DELAY 1ul
+
+// Time (in seconds) the tasks of a bundle should take overall and maximum number of tasks in it 
+#define BUNDLE_TARGET_SECS 1e-3
+#define MAX_BUNDLE_SIZE 64u
+
 namespace mpits {
 
-namespace {
+namespace {
+
+	typedef std::tuple<Task::TaskID, KernelRegistry::KernelID, unsigned, unsigned, std::string, Task::InputList, Task::FileList> TaskInfo;
+
+	TaskInfo task_info(const TaskPtr& t) {
+		return std::make_tuple(t->tid(), t->kernel(), t->min(), t->max(), t->args(), t->inputs(), t->files());
+	}
+
+	TaskPtr make_task(const TaskInfo& info) {
+		return std::make_shared<Task>(
+				std::get<0>(info), std::get<1>(info), std::get<2>(info), std::get<3>(info), 
+				std::get<4>(info), std::get<5>(info), std::get<6>(info)
+			);
+	}
+
+	/**
+	 * Node holding most of the input bytes of a task, -1 if the task declared no inputs 
+	 */
+	int input_node(const Task& t) {
+		std::map<unsigned, unsigned long> bytes;
+		for (const auto& cur : t.inputs()) { 
+			if (cur.id) { bytes[ObjectStore::node_of(cur.id)] += cur.size; }
+		}
+
+		int best = -1;
+		unsigned long best_bytes = 0;
+		for (const auto& cur : bytes) {
+			if (best < 0 || cur.second > best_bytes) { 
+				best = cur.first; 
+				best_bytes = cur.second;
+			}
+		}
+		return best;
+	}
+
+	bool uses_stream(const Task& t, const ObjectID& id) {
+		return std::any_of(t.inputs().begin(), t.inputs().end(), 
+						   [&](const ObjectRef& cur) { return cur.id == id; });
+	}
+
+	/**
+	 * The two ends of a stream busy-wait for each other, the queued tasks using a stream 
+	 * which no task opened yet are started together (also the tasks at the ends of their 
+	 * other streams). Returns the gang of t, t first, or an empty gang while a task at 
+	 * the other end of one of its streams is not ready.
+	 */
+	std::vector<TaskPtr> stream_gang(Scheduler& sched, const TaskPtr& t) {
+
+		std::vector<TaskPtr> gang(1, t);
+		for (size_t idx=0; idx<gang.size(); ++idx) {
+			for (const auto& in : gang[idx]->inputs()) {
+				if (!sched.store().is_stream(in.id) || sched.store().stream_started(in.id)) { continue; }
+
+				unsigned ends = 0;
+				for (const auto& cur : sched.ready_tasks()) {
+					if (!uses_stream(*cur, in.id)) { continue; }
+
+					++ends;
+					if (std::find(gang.begin(), gang.end(), cur) == gang.end()) { gang.push_back(cur); }
+				}
+				if (ends < 2) { return std::vector<TaskPtr>(); }
+			}
+		}
+		return gang;
+	}
+
+	// True if t can be started on its own: every stream it uses was opened already 
+	bool starts_alone(const Scheduler& sched, const Task& t) {
+		return std::none_of(t.inputs().begin(), t.inputs().end(), [&](const ObjectRef& cur) { 
+				return sched.store().is_stream(cur.id) && !sched.store().stream_started(cur.id); 
+			});
+	}
+
+	/**
+	 * Rank of this node which produced most of the input bytes of a task, the group of 
+	 * the task is placed around it. Returns -1 if no input was produced on this node.
+	 */
+	int input_rank(const Scheduler& sched, const Task& t) {
+		std::map<int, unsigned long> bytes;
+		for (const auto& cur : t.inputs()) { 
+			int rank = sched.store().producer(cur.id);
+			if (rank >= 0) { bytes[rank] += cur.size; }
+		}
+
+		int best = -1;
+		unsigned long best_bytes = 0;
+		for (const auto& cur : bytes) {
+			if (best < 0 || cur.second > best_bytes) { 
+				best = cur.first; 
+				best_bytes = cur.second;
+			}
+		}
+		return best;
+	}
+
+	void wakeup_group(const Scheduler& sched, const std::vector<int>& ranks, const Task::TaskID& tid);
+
+	bool task_spawn(Scheduler& sched);
+
+	void try_steal(Scheduler& sched);
+
+	bool start_span(Scheduler& sched);
+
+	void dispatch_task(Scheduler& sched, const TaskPtr& task);
+
+	void send_task(Scheduler& sched, const TaskPtr& t, int leader);
+
+	template <class Functor>
+	inline void resume_workers(Scheduler& sched, const std::vector<int>& ranks, const Functor& func) {
+
+		for(int idx : ranks) {
+			kill(sched.pid_list()[idx-1].second, SIGCONT);
+			func(idx);
+		}
+
+	}
+
+	/**
+	 * Sends a task created by this scheduler to the node holding its inputs 
+	 */
+	void forward_task(Scheduler& sched, const TaskPtr& task, int node) {
+
+		LOG(INFO) << "Forwarding Task: " << *task << " to node " << node << ", which holds its inputs";
+
+		// arguments in shared memory cannot be mapped on the other node 
+		TaskInfo info = task_info(task);
+		std::get<4>(info) = Payload::make_inline(std::get<4>(info));
+
+		sched.remote_tasks().leave(task->tid());
+		comm::SendChannel()( 
+			comm::Message(comm::Message::TASK_FORWARD, node, sched.sched_comm(), info) 
+		);
+	}
+
+	/**
+	 * Drops a task which can never run (wider than all the nodes together or running an 
+	 * unknown kernel), the task completes without a result so that its waiters and 
+	 * successors are not blocked forever 
+	 */
+	void drop_task(Scheduler& sched, const TaskPtr& task) {
+
+		Payload::release(task->args());
+
+		Task::TaskID tid = task->tid();
+		unsigned owner = Task::owner(tid);
+		if (owner != static_cast<unsigned>(sched.sched_rank())) {
+			comm::SendChannel()( 
+				comm::Message(comm::Message::TASK_REMOTE_COMPLETED, owner, sched.sched_comm(), 
+							  std::make_tuple(tid, std::string())) 
+			);
+			return;
+		}
+
+		// the task may have come back after being handed to another node 
+		sched.remote_tasks().complete(tid);
+		sched.memo_calls().erase(tid);
+		sched.cmd_queue().push( Event(Event::TASK_COMPLETED, utils::any(std::move(tid))) );
+	}
+
+	/**
+	 * The kernel of a task is validated once, when the task is created, and only its id 
+	 * travels afterwards. Tasks running unknown kernels are dropped, returns false if so.
+	 */
+	bool known_kernel(Scheduler& sched, const TaskPtr& task) {
+		if (task->kernel() < sched.kernels().size()) { return true; }
+
+		LOG(ERROR) << "Kernel " << task->kernel() << " of task " << *task << " not registered: dropped";
+		drop_task(sched, task);
+		return false;
+	}
+
+	/**
+	 * Pushes a task into the task queue hosted by the scheduler, tasks created here 
+	 * whose inputs are mostly stored by another node are forwarded to that node. Batches 
+	 * of tasks are announced by their creator (notify false).
+	 */
+	void add_task(Scheduler& sched, const TaskPtr& task, bool notify=true) {
+
+		if (task->min() > sched.cluster_ranks()) {
+			LOG(ERROR) << "Task " << *task << " needs " << task->min() << " ranks, only " 
+					   << sched.cluster_ranks() << " are available: dropped";
+			drop_task(sched, task);
+			return;
+		}
+
+		int node = input_node(*task);
+		if (node >= 0 && node < sched.sched_size() && node != sched.sched_rank() && 
+			Task::owner(task->tid()) == static_cast<unsigned>(sched.sched_rank())) 
+		{
+			forward_task(sched, task, node);
+			return;
+		}
+
+		// the input files are staged while the task waits in the queue 
+		for (const auto& file : task->files()) { sched.staging().prefetch(file); }
+
+		sched.enqueue_task( task );
+		
+		LOG(INFO) << "Created Task: " << *task; 
+
+		// create an event 
+		if (notify) {
+			sched.cmd_queue().push( Event(Event::TASK_CREATED, utils::any(Task::TaskID(task->tid()))) );
+		}
+	}
+
+	/**
+	 * Holds a task until all its predecessors complete. Returns false if the 
+	 * predecessors already completed, the task can then be queued right away. 
+	 */
+	bool block_task(Scheduler& sched, const TaskPtr& task, const Task::TaskIDList& deps, bool place) {
+
+		unsigned pending = 0;
+		for (auto dep : deps) {
+			if (sched.is_completed(dep)) { continue; }
+
+			sched.successors()[dep].push_back(task->tid());
+			++pending;
+		}
+
+		if (pending == 0) { return false; }
+
+		LOG(INFO) << "Task " << *task << " waiting for " << pending << " predecessor(s)";
+
+		Scheduler::BlockedTask blocked = { task, pending, place };
+		sched.blocked_tasks().insert( {task->tid(), blocked} );
+		return true;
+	}
+
+	/**
+	 * Completes right away a task running a pure kernel whose result is cached, no worker 
+	 * is involved. Otherwise records the key under which the result of the task is cached 
+	 * once it completes.
+	 */
+	bool memoized(Scheduler& sched, const TaskPtr& task) {
+
+		if (sched.memo().capacity() == 0 || !(sched.kernels()[task->kernel()].flags & KernelDesc::PURE)) 
+		{ 
+			return false; 
+		}
+
+		Payload args(task->args());
+		if (!args.valid() || args.size() > sched.memo().capacity()) { return false; }
+
+		MemoCache::Call call = { task->kernel(), std::string(args.data(), args.size()) };
+
+		std::string result;
+		if (!sched.memo().lookup(call, result)) {
+			sched.memo_calls()[task->tid()] = std::move(call);
+			return false;
+		}
+
+		LOG(INFO) << "Task " << *task << " completed with the cached result of " << sched.kernels()[task->kernel()].name;
+
+		// the arguments are never read 
+		Payload::release(task->args());
+
+		if (!result.empty()) { sched.results()[task->tid()] = std::move(result); }
+		sched.cmd_queue().push( Event(Event::TASK_COMPLETED, utils::any(Task::TaskID(task->tid()))) );
+		return true;
+	}
+
+	// Caches the result of a completed task if it runs a pure kernel 
+	void memoize(Scheduler& sched, const Task::TaskID& tid, const std::string& result) {
+
+		auto fit = sched.memo_calls().find(tid);
+		if (fit == sched.memo_calls().end()) { return; }
+
+		MemoCache::Call call = std::move(fit->second);
+		sched.memo_calls().erase(fit);
+
+		if (Payload::size(result) > sched.memo().capacity()) { return; }
+
+		// the result itself is handed out (and its shared memory object released) once 
+		Payload view(result);
+		if (view.valid()) { sched.memo().insert(call, Payload::encode(view.str(), ~size_t(0))); }
+	}
+
+	/**
+	 * Queues a task whose predecessors completed, tasks submitted to the global scheduler 
+	 * are placed 
+	 */
+	void release_task(Scheduler& sched, const TaskPtr& task, bool place, bool notify=true) {
+		if (memoized(sched, task)) { return; }
+
+		if (place) { 
+			dispatch_task(sched, task); 
+		} else {
+			add_task(sched, task, notify);
+		}
+	}
+
+	/**
+	 * Creates a task and push it into the task queue hosted by the 
+	 * scheduler 
+	 */
+	void create_task(Scheduler& 				sched, 
+					 const Task::TaskID& 		tid,
+					 const KernelRegistry::KernelID& kernel, 
+					 unsigned 					min, 
+					 unsigned 					max,
+					 const Task::TaskIDList& 	deps,
+					 const std::string& 		args,
+					 const Task::InputList& 	inputs,
+					 const Task::FileList& 		files) 
+	{
+		auto task = std::make_shared<Task>(tid, kernel, min, max, args, inputs, files);
+		if (!known_kernel(sched, task)) { return; }
+
+		if (!block_task(sched, task, deps, false)) { release_task(sched, task, false); }
+	}
+
+	Task::TaskID create_task(Scheduler& 				sched, 
+							 const KernelRegistry::KernelID& kernel, 
+							 unsigned 					min, 
+							 unsigned 					max,
+							 const Task::TaskIDList& 	deps,
+							 const std::string& 		args,
+							 const Task::InputList& 	inputs,
+							 const Task::FileList& 		files) 
+	{
+		Task::TaskID tid = sched.next_tid();
+		create_task(sched, tid, kernel, min, max, deps, args, inputs, files);
+		return tid;
+	}
+
+	// Removes the shared memory objects evicted from the object store 
+	void remove_objects(const ObjectStore::ObjectList& ids) {
+		for (auto id : ids) {
+			LOG(DEBUG) << "Evicting object " << std::hex << id << std::dec;
+			utils::shm_remove(ObjectStore::name(id));
+		}
+	}
+
+	/**
+	 * Updates the load of a node kept by the global scheduler. The node acknowledges 
+	 * the placements it received since its last report, they are now part of its load
+	 */
+	void apply_load(Scheduler& sched, int node, int free, int queued, unsigned placed) {
+		auto& load = sched.cluster_load()[node];
+		load.free += free;
+		load.queued += queued;
+
+		for (; placed; --placed) {
+			assert(!load.in_flight.empty());
+			load.in_flight_ranks -= load.in_flight.front();
+			load.in_flight.pop_front();
+		}
+	}
+
+	/**
+	 * Sends to the global scheduler the change in the load of this node since the 
+	 * previous report (if any)
+	 */
+	void report_load(Scheduler& sched) {
+
+		if (!sched.global_tier()) { return; }
+
+		int free = sched.free_ranks().count();
+		int queued = sched.ready_tasks().size();
+
+		int dfree = free - sched.reported_free(), dqueued = queued - sched.reported_queued();
+		if (dfree == 0 && dqueued == 0 && sched.placed() == 0) { return; }
+
+		if (sched.sched_rank() == 0) {
+			apply_load(sched, 0, dfree, dqueued, sched.placed());
+		} else {
+			comm::SendChannel()( 
+				comm::Message(comm::Message::LOAD_DELTA, 0, sched.sched_comm(), 
+							  std::make_tuple(dfree, dqueued, sched.placed())) 
+			);
+		}
+
+		sched.reported_free() = free;
+		sched.reported_queued() = queued;
+		sched.placed() = 0;
+	}
+
+	/**
+	 * Selects the node for a task: the node holding most of its inputs, otherwise the best 
+	 * fit among the nodes which can start the task right away or the node with the 
+	 * shortest queue
+	 */
+	int place_task(Scheduler& sched, const Task& t) {
+
+		const auto& load = sched.cluster_load();
+
+		int node = input_node(t);
+		if (node >= 0 && node < static_cast<int>(load.size())) { return node; }
+
+		unsigned min = t.min();
+
+		int best = -1, best_free = 0;
+		for (int node=0; node<static_cast<int>(load.size()); ++node) {
+			int free = load[node].free - load[node].in_flight_ranks;
+			if (free >= static_cast<int>(min) && (best < 0 || free < best_free)) { 
+				best = node; 
+				best_free = free;
+			}
+		}
+		if (best >= 0) { return best; }
+
+		size_t best_queue = 0;
+		for (int node=0; node<static_cast<int>(load.size()); ++node) {
+			size_t queue = std::max(load[node].queued, 0) + load[node].in_flight.size();
+			if (best < 0 || queue < best_queue) { 
+				best = node; 
+				best_queue = queue;
+			}
+		}
+		return best;
+	}
+
+	/**
+	 * Creates count tasks with contiguous tids, each of them is released as a single task 
+	 * would be but the batch is announced with a single event 
+	 */
+	TaskRange create_tasks(Scheduler& 			sched, 
+						   const KernelRegistry::KernelID& kernel, 
+						   unsigned 			count, 
+						   unsigned 			min, 
+						   unsigned 			max) 
+	{
+		TaskRange range = { sched.next_tids(count), count };
+
+		for (unsigned idx=0; idx<count; ++idx) {
+			auto task = std::make_shared<Task>(range[idx], kernel, min, max);
+			if (known_kernel(sched, task)) { release_task(sched, task, false, false); }
+		}
+
+		if (count) {
+			LOG(INFO) << "Created " << count << " tasks: [TID:" << range.first << "..." 
+					  << range[count-1] << "]";
+		}
+
+		sched.cmd_queue().push( Event(Event::TASKS_CREATED, utils::any(Task::TaskID(range.first), unsigned(count))) );
+		return range;
+	}
+
+	/**
+	 * Sends a task to the node selected by the global scheduler 
+	 */
+	void dispatch_task(Scheduler& sched, const TaskPtr& task) {
+
+		int node = place_task(sched, *task);
+
+		auto& load = sched.cluster_load()[node];
+		load.in_flight.push_back(task->min());
+		load.in_flight_ranks += task->min();
+
+		if (node == sched.sched_rank()) {
+			++sched.placed();
+			add_task(sched, task);
+			return;
+		}
+
+		LOG(INFO) << "Placing Task: " << *task << " on node " << node;
+
+		// arguments in shared memory cannot be mapped on the other node 
+		TaskInfo info = task_info(task);
+		std::get<4>(info) = Payload::make_inline(std::get<4>(info));
+
+		sched.remote_tasks().leave(task->tid());
+		comm::SendChannel()( 
+			comm::Message(comm::Message::TASK_PLACE, node, sched.sched_comm(), info) 
+		);
+	}
+
+	/**
+	 * Creates a task to be placed by the global scheduler 
+	 */
+	Task::TaskID submit_task(Scheduler& 				sched, 
+							 const KernelRegistry::KernelID& kernel, 
+							 unsigned 					min, 
+							 unsigned 					max,
+							 const Task::TaskIDList& 	deps,
+							 const std::string& 		args,
+							 const Task::InputList& 	inputs,
+							 const Task::FileList& 		files) 
+	{
+		Task::TaskID tid = sched.next_tid();
+
+		auto task = std::make_shared<Task>(tid, kernel, min, max, args, inputs, files);
+		if (!known_kernel(sched, task)) { return tid; }
+
+		if (!block_task(sched, task, deps, true)) { release_task(sched, task, true); }
+
+		return tid;
+	}
+
+	/**
+	 * Releases the tasks whose last pending predecessor is tid
+	 */
+	void release_successors(Scheduler& sched, const Task::TaskID& tid) {
+
+		auto fit = sched.successors().find(tid);
+		if (fit == sched.successors().end()) { return; }
+
+		for (auto succ : fit->second) {
+			auto bit = sched.blocked_tasks().find(succ);
+			assert(bit != sched.blocked_tasks().end());
+
+			if (--bit->second.pending > 0) { continue; }
+
+			Scheduler::BlockedTask blocked = bit->second;
+			sched.blocked_tasks().erase(bit);
+
+			release_task(sched, blocked.task, blocked.place);
+		}
+		sched.successors().erase(fit);
+	}
+
+	/**
+	 * Resumes a suspended task, the workers receive the tid of the task, the tid of the 
+	 * task whose completion woke it up and the size of its result. The result (if any) 
+	 * is handed to the group leader, when it runs on this node, right after. 
+	 */
+	void resume_task(Scheduler& sched, const Task::TaskID& tid, bool leader=true) {
+		auto& t = sched.active_tasks()[tid];
+
+		std::string result = leader ? sched.take_result(t->wakeup()) : std::string();
+
+		auto msg = [&](const int& idx) { 
+			int pid = sched.pid_list()[idx-1].first;
+			bool first = idx == t->ranks().front();
+
+			Task::TaskID desc[3] = { tid, t->wakeup(), first ? result.size() : 0 };
+			MPI_Send(desc, 3, MPI_UNSIGNED_LONG, pid, 3, sched.node_comm());
+
+			if (first && !result.empty()) {
+				MPI_Send(const_cast<char*>(result.data()), result.size(), MPI_BYTE, pid, 3, sched.node_comm());
+			}
+		};
+
+		resume_workers(sched, t->ranks(), msg);
+
+		// The ranks of the task hosted by other nodes are resumed by their schedulers
+		for (int peer : t->peers()) {
+			comm::SendChannel()( 
+				comm::Message(comm::Message::SPAN_RESUME, peer, sched.sched_comm(), 
+							  std::make_tuple(tid, t->wakeup())) 
+			);
+		}
+	}
+
+	/**
+	 * Registers a single event handler invoking callback once all the tasks in tids 
+	 * (or any of them) completed, the callback receives the tid of the last completed 
+	 * task. Returns false, without registering the handler, if the condition already 
+	 * holds; completed is then set to one of the completed tasks (0 if tids is empty).
+	 */
+	bool wait_tasks(Scheduler& 										sched, 
+					const Task::TaskIDList& 						tids, 
+					bool 											any, 
+					Task::TaskID& 									completed,
+					const std::function<void (const Task::TaskID&)>& callback) 
+	{
+		auto pending = std::make_shared<std::set<Task::TaskID>>();
+
+		completed = 0;
+		for (auto tid : tids) {
+			if (!sched.is_completed(tid)) { 
+				pending->insert(tid); 
+				continue;
+			}
+
+			completed = tid;
+			if (any) { return false; }
+		}
+
+		if (pending->empty()) { return false; }
+
+		sched.handler().connect(
+				Event::TASK_COMPLETED, 
+				std::function<bool (const Task::TaskID&)>(
+					[=](const Task::TaskID& cur) {
+						pending->erase(cur);
+						if (!any && !pending->empty()) { return false; }
+
+						callback(cur);
+						return true;
+					}
+				),
+				// Filter the tasks we are waiting for 
+				std::function<bool (const Task::TaskID&)>(
+					[=](const Task::TaskID& cur) { return pending->count(cur) > 0; }
+				)
+			);
+		return true;
+	}
+
+	/**
+	 * Wakes up the local ranks of a task sending them the list of world ranks which 
+	 * form the group 
+	 */
+	void launch_group(Scheduler& sched, const std::vector<int>& ranks, const std::vector<int>& group) {
+
+		auto msg = [&](const int& idx) { 
+			MPI_Send(const_cast<int*>(&group.front()), group.size(), 
+					 MPI_INT, sched.pid_list()[idx-1].first, 1, sched.node_comm()
+			);
+		};
+
+		resume_workers(sched, ranks, msg);
+	}
+
+	/**
+	 * Activates a task on the given ranks, the first rank becomes the group leader 
+	 */
+	void launch_task(Scheduler& 				sched, 
+					 const TaskPtr& 			t, 
+					 const std::vector<int>& 	ranks, 
+					 const std::vector<int>& 	group, 
+					 const std::vector<int>& 	peers=std::vector<int>()) 
+	{
+		// Store the task as an Active task
+		sched.active_tasks().insert( 
+			std::make_pair(t->tid(), std::make_shared<LocalTask>(*t, ranks, peers)) 
+		);
+
+		launch_group(sched, ranks, group);
+		send_task(sched, t, ranks.front());
+	}
+
+	/**
+	 * Sends to the leader of a group the tid of the task, the id of the kernel to be 
+	 * invoked and the packed arguments
+	 */
+	void send_task(Scheduler& sched, const TaskPtr& t, int leader) {
+
+		Task::TaskID desc[3] = { t->tid(), t->kernel(), t->args().size() };
+		MPI_Send(desc, 3, MPI_UNSIGNED_LONG, leader, 0, sched.node_comm());
+
+		// followed by the packed arguments, if any 
+		if (!t->args().empty()) {
+			MPI_Send(const_cast<char*>(t->args().data()), t->args().size(), MPI_BYTE, 
+					 leader, 0, sched.node_comm());
+		}
+	}
+
+	/**
+	 * Pipelined launch: the ranks of a task whose leader reached the end of the kernel are 
+	 * handed to the first queued task fitting within them. The ranks receive the group of 
+	 * the new task right away, without being signalled, and build it as soon as they are 
+	 * done with the current task; the task itself is sent once the completion is reported. 
+	 * Ranks wanted by woken tasks and tasks spanning multiple nodes are left alone.
+	 */
+	void preassign_task(Scheduler& sched, const LocalTaskPtr& finishing) {
+
+		const std::vector<int>& ranks = finishing->ranks();
+		if (!finishing->peers().empty() || finishing->successor()) { return; }
+
+		for (int rank : ranks) {
+			if (sched.rank_wanted(rank)) { return; }
+		}
+
+		auto& queue = sched.ready_tasks();
+		auto fit = std::find_if(queue.begin(), queue.end(), 
+				[&](const TaskPtr& cur) { 
+					return !std::dynamic_pointer_cast<LocalTask>(cur) && cur->min() <= ranks.size() && 
+						   starts_alone(sched, *cur); 
+				});
+
+		if (fit == queue.end()) { return; }
+
+		TaskPtr t = *fit;
+		queue.erase(fit);
+
+		// The task keeps the leader of the finishing one and, as any launch, gets min ranks
+		std::vector<int> assigned(ranks.begin(), ranks.begin() + t->min());
+		finishing->successor() = t->tid();
+
+		LOG(DEBUG) << "Pre-assigning ranks of task " << finishing->tid() << " to task: " << *t;
+
+		sched.active_tasks().insert( 
+			std::make_pair(t->tid(), std::make_shared<LocalTask>(*t, assigned)) 
+		);
+
+		std::vector<int> group = sched.world_ranks(assigned);
+		for (int idx : assigned) {
+			MPI_Send(&group.front(), group.size(), MPI_INT, sched.pid_list()[idx-1].first, 1, sched.node_comm());
+		}
+	}
+
+	/**
+	 * Completes a task executed on this node: its ranks are released (or handed to the 
+	 * task pre-assigned to them), the owner of the task receives the result and the 
+	 * completion event is generated 
+	 */
+	void complete_task(Scheduler& sched, const Task::TaskID& tid, std::string&& result) {
+
+		auto& active_tasks = sched.active_tasks();
+		auto fit = active_tasks.find(tid);
+		assert(fit != active_tasks.end());
+
+		// Make the pids available for successive tasks, except the ones pre-assigned 
+		LocalTaskPtr next;
+		if (fit->second->successor()) { 
+			next = active_tasks[fit->second->successor()];
+			assert(next);
+		}
+
+		std::vector<int> released;
+		for (int rank : fit->second->ranks()) {
+			if (!next || std::find(next->ranks().begin(), next->ranks().end(), rank) == next->ranks().end()) { 
+				released.push_back(rank); 
+			}
+		}
+		sched.release_pids(released); 
+		sched.task_executed(*fit->second);
+
+		for (const auto& file : fit->second->files()) { sched.staging().release(file); }
+
+		// Release the ranks hosted by other nodes 
+		for (int peer : fit->second->peers()) {
+			comm::SendChannel()( 
+				comm::Message(comm::Message::SPAN_RELEASE, peer, sched.sched_comm(), std::make_tuple(tid)) 
+			);
+		}
+
+		// Remove the task
+		active_tasks.erase(fit);
+
+		// The ranks may be sleeping already, they are woken up before the task is sent 
+		if (next) {
+			resume_workers(sched, next->ranks(), [](const int&) { });
+			next->restart();
+			send_task(sched, next, next->ranks().front());
+		}
+
+		// The task was stolen from another node, let the owner know it completed 
+		unsigned owner = Task::owner(tid);
+		if (owner != static_cast<unsigned>(sched.sched_rank())) {
+			comm::SendChannel()( 
+				comm::Message(comm::Message::TASK_REMOTE_COMPLETED, owner, sched.sched_comm(), 
+						std::make_tuple(tid, Payload::make_inline(result))) 
+			);
+		} else {
+			// the task may have been stolen back after being handed to another node 
+			sched.remote_tasks().complete(tid);
+			memoize(sched, tid, result);
+			if (!result.empty()) { sched.results()[tid] = std::move(result); }
+		}
+
+		sched.cmd_queue().push(
+			Event(Event::TASK_COMPLETED, utils::any(Task::TaskID(tid))) 
+		);
+	}
+
+	/**
+	 * Work-first handoff: when a task suspends waiting for children which are still queued, 
+	 * the first of them fitting within the ranks of the suspended task is launched right 
+	 * away on those ranks, ahead of the ready queue. The ranks the child does not need are 
+	 * released. Returns false if no child could be handed the ranks.
+	 */
+	bool handoff_child(Scheduler& sched, const LocalTaskPtr& parent, const Task::TaskIDList& tids) {
+
+		const std::vector<int>& ranks = parent->ranks();
+
+		auto& queue = sched.ready_tasks();
+		auto fit = std::find_if(queue.begin(), queue.end(), 
+				[&](const TaskPtr& cur) { 
+					return !std::dynamic_pointer_cast<LocalTask>(cur) && 
+						   cur->min() <= ranks.size() && starts_alone(sched, *cur) && 
+						   std::find(tids.begin(), tids.end(), cur->tid()) != tids.end(); 
+				});
+
+		if (fit == queue.end()) { return false; }
+
+		TaskPtr t = *fit;
+		queue.erase(fit);
+
+		// The child keeps the leader of the parent, the remaining ranks are released 
+		std::vector<int> child_ranks(ranks.begin(), ranks.begin()+t->min());
+		sched.release_pids(std::vector<int>(ranks.begin()+t->min(), ranks.end()));
+
+		LOG(DEBUG) << "Handing ranks of task " << parent->tid() << " over to task: " << *t;
+
+		launch_task(sched, t, child_ranks, sched.world_ranks(child_ranks));
+		return true;
+	}
+
+	/**
+	 * Gives back the ranks held by a co-allocation, the task returns to the head of the queue 
+	 */
+	void span_abort(Scheduler& sched, const Scheduler::SpanRequestPtr& req) {
+
+		for (int peer : req->peers) {
+			comm::SendChannel()( 
+				comm::Message(comm::Message::SPAN_CANCEL, peer, sched.sched_comm(), 
+							  std::make_tuple(req->task->tid())) 
+			);
+		}
+		sched.release_pids(req->local_ranks);
+		sched.ready_tasks().push_front(req->task);
+	}
+
+	/**
+	 * Retries the co-allocation of the queued wide tasks after a randomised exponential 
+	 * backoff (see SpanPolicy)
+	 */
+	void span_retry(Scheduler& sched) {
+
+		size_t delay = SpanPolicy::retry_delay(SPAN_RETRY_DELAY, MAX_SPAN_RETRY_DELAY, 
+											   sched.span_retries()++, sched.jitter());
+		sched.cmd_queue().push( 
+			Event(Event::SPAN_RETRY, utils::any(true), 
+				  std::chrono::high_resolution_clock::now() + 
+				  std::chrono::milliseconds(delay)) 
+		);
+	}
+
+	/**
+	 * Asks the next peer scheduler for the ranks still needed by the pending co-allocation, 
+	 * the task is launched as soon as all the ranks are reserved. If the peers cannot 
+	 * provide enough ranks the reservations are cancelled and the allocation retried later.
+	 */
+	void span_next(Scheduler& sched) {
+
+		auto req = sched.span();
+		assert(req);
+
+		if (req->needed == 0) {
+			LOG(DEBUG) << "Launching task " << *req->task << " on ranks " << utils::join(req->group);
+
+			for (int peer : req->peers) {
+				comm::SendChannel()( 
+					comm::Message(comm::Message::SPAN_LAUNCH, peer, sched.sched_comm(), 
+								  std::make_tuple(req->task->tid(), req->group)) 
+				);
+			}
+			launch_task(sched, req->task, req->local_ranks, req->group, req->peers);
+
+			sched.span().reset();
+			sched.span_retries() = 0;
+			return;
+		}
+
+		if (req->next_peer == sched.sched_size()) {
+			LOG(DEBUG) << "Not enough ranks for task " << *req->task << ", retrying later";
+
+			span_abort(sched, req);
+			sched.span().reset();
+			span_retry(sched);
+			return;
+		}
+
+		int peer = (sched.sched_rank() + req->next_peer++) % sched.sched_size();
+		comm::SendChannel()( 
+			comm::Message(comm::Message::SPAN_RESERVE, peer, sched.sched_comm(), 
+						  std::make_tuple(req->task->tid(), req->needed)) 
+		);
+	}
+
+	/**
+	 * Starts the co-allocation of the first queued task which is wider than this node
+	 */
+	bool start_span(Scheduler& sched) {
+
+		if (sched.sched_size() == 1 || sched.span()) { return false; }
+
+		unsigned width = sched.node_size()-1;
+		unsigned free = sched.free_ranks().count();
+		if (free == 0) { return false; }
+
+		auto& queue = sched.ready_tasks();
+		auto fit = std::find_if(queue.begin(), queue.end(), [&](const TaskPtr& t) { 
+				return !std::dynamic_pointer_cast<LocalTask>(t) && t->min() > width && starts_alone(sched, *t);
+			});
+
+		if (fit == queue.end()) { return false; }
+
+		auto req = std::make_shared<Scheduler::SpanRequest>();
+		req->task = *fit;
+		queue.erase(fit);
+
+		req->local_ranks = sched.free_ranks().acquire(free);
+		req->group = sched.world_ranks(req->local_ranks);
+		req->needed = req->task->min() - free;
+		req->next_peer = 1;
+		req->yielded = false;
+
+		LOG(DEBUG) << "Co-allocating task " << *req->task << ": " << req->needed 
+				   << " rank(s) needed from other nodes";
+
+		sched.span() = req;
+		span_next(sched);
+		return true;
+	}
+
+	/**
+	 * Removes from the ready queue half of the tasks which this node cannot start right 
+	 * now and which fit within the idle ranks of the thief (width). Only tasks which were 
+	 * not started yet can be stolen, suspended tasks are bound to the ranks of this node. 
+	 */
+	std::vector<TaskInfo> steal_half(Scheduler& sched, unsigned width) {
+
+		auto& queue = sched.ready_tasks();
+		unsigned free = sched.free_ranks().count();
+
+		// tasks whose arguments or inputs are in the shared memory of the node stay here 
+		auto stealable = [&](const TaskPtr& t) { 
+			return !std::dynamic_pointer_cast<LocalTask>(t) && t->min() > free && t->min() <= width && 
+				   !Payload::is_shared(t->args()) && t->inputs().empty();
+		};
+
+		size_t n = std::count_if(queue.begin(), queue.end(), stealable);
+		n = (n+1)/2;
+
+		// steal from the tail of the queue, the oldest tasks stay with the victim 
+		std::vector<TaskInfo> stolen;
+		for (auto it = queue.end(); it != queue.begin() && stolen.size() < n; ) {
+			--it;
+			if (!stealable(*it)) { continue; }
+
+			const TaskPtr& t = *it;
+			stolen.push_back( task_info(t) );
+
+			// the thief stages the files on its node 
+			for (const auto& file : t->files()) { sched.staging().release(file); }
+
+			if (Task::owner(t->tid()) == static_cast<unsigned>(sched.sched_rank())) {
+				sched.remote_tasks().leave(t->tid());
+			}
+			it = queue.erase(it);
+		}
+		return stolen;
+	}
+
+	/**
+	 * Sends a work request to a randomly selected peer scheduler if this node has idle 
+	 * ranks. At most one request is in flight at any time. 
+	 */
+	void try_steal(Scheduler& sched) {
+
+		if (sched.sched_size() == 1 || sched.steal_pending() || sched.finalizing()) { return; }
+
+		unsigned free = sched.free_ranks().count();
+		if (free == 0) { return; }
+
+		int victim = sched.random_peer();
+		LOG(DEBUG) << "Requesting work for " << free << " idle ranks from scheduler " << victim;
+
+		sched.steal_pending() = true;
+		comm::SendChannel()( 
+			comm::Message(comm::Message::TASK_STEAL, victim, sched.sched_comm(), std::make_tuple(free)) 
+		);
+	}
+
+	/** 
+	 * Handle incoming messages to the scheduler by implementeing their 
+	 * semantic actions 
+	 */
+	bool message_dispatch(Scheduler& sched, const comm::Message& msg) {
+
+		using namespace comm;
+
+		switch(msg.msg_id()) {
+
+		case Message::TASK_CREATE: 
+			/**
+			 * The tid was taken by the worker from a block leased by this scheduler, 
+			 * therefore no reply is needed 
+			 */
+			{
+
+				typedef std::tuple<Task::TaskID,KernelRegistry::KernelID,unsigned,unsigned,Task::TaskIDList,std::string,
+								   Task::InputList,Task::FileList> ContentType;
+
+				auto content = msg.get_content_as<ContentType>();
+				sched.tid_used(std::get<0>(content));
+
+				create_task(sched, std::get<0>(content), std::get<1>(content), std::get<2>(content), 
+							std::get<3>(content), std::get<4>(content), std::get<5>(content), 
+							std::get<6>(content), std::get<7>(content));
+				break;
+			}
+
+		case Message::TID_LEASE: 
+			/**
+			 * Leases a block of tids to a worker, the reply uses a dedicated tag which 
+			 * the worker receives with a pre-posted receive
+			 */
+			{
+				unsigned count = std::get<0>(msg.get_content_as<std::tuple<unsigned>>());
+
+				Task::TaskID first = sched.lease_tids(count);
+				MPI_Send(&first, 1, MPI_UNSIGNED_LONG, msg.endpoint(), 4, msg.comm()); 
+				break;
+			}
+
+		case Message::TASK_CREATE_N: 
+			{
+				auto content = msg.get_content_as<std::tuple<KernelRegistry::KernelID,unsigned,unsigned,unsigned>>();
+
+				TaskRange range = 
+					create_tasks(sched, std::get<0>(content), std::get<1>(content), 
+								 std::get<2>(content), std::get<3>(content));
+
+				MPI_Send(&range.first, 1, MPI_UNSIGNED_LONG, msg.endpoint(), 0, msg.comm()); 
+				break;
+			}
+
+		case Message::TASK_COMPLETED:
+			/**
+			 * When we receive a message from the master worker saying that the task is completed 
+			 * we all generate an internal event. The message carries the result of the task.
+			 */
+			{	
+				auto desc = msg.get_content_as<std::tuple<Task::TaskID, std::string>>();
+				
+				Task::TaskID tid = std::get<0>(desc);
+				auto fit = sched.active_tasks().find(tid);
+				assert(fit != sched.active_tasks().end());
+
+				// the runtimes of single rank tasks size the bundles of their kernel 
+				if (fit->second->ranks().size() == 1) {
+					std::chrono::duration<double> elapsed = 
+						std::chrono::high_resolution_clock::now() - fit->second->start_time();
+					sched.kernel_stats().record(fit->second->kernel(), elapsed.count());
+				}
+
+				complete_task(sched, tid, std::move(std::get<1>(desc)));
+				break;
+			}
+
+		case Message::TASK_BUNDLE_COMPLETED:
+			/**
+			 * A worker ran a bundle of tasks, the message carries their results and the time 
+			 * each of them took. The first task of the bundle holds the rank of the worker, 
+			 * it is completed last so that the rank is released once.
+			 */
+			{
+				auto desc = msg.get_content_as<
+					std::tuple<Task::TaskIDList, std::vector<std::string>, std::vector<double>>
+				>();
+
+				const Task::TaskIDList& tids = std::get<0>(desc);
+				assert(!tids.empty() && tids.size() == std::get<1>(desc).size() && 
+					   tids.size() == std::get<2>(desc).size());
+
+				for (size_t idx=tids.size(); idx-- > 0; ) {
+					auto fit = sched.active_tasks().find(tids[idx]);
+					assert(fit != sched.active_tasks().end());
+
+					sched.kernel_stats().record(fit->second->kernel(), std::get<2>(desc)[idx]);
+					complete_task(sched, tids[idx], std::move(std::get<1>(desc)[idx]));
+				}
+				break;
+			}
+
+		case Message::TASK_FINISHING:
+			/**
+			 * The leader of a task reached the end of the kernel, the ranks of the task 
+			 * are about to become idle 
+			 */
+			{
+				Task::TaskID tid = std::get<0>(msg.get_content_as<std::tuple<Task::TaskID>>());
+
+				auto fit = sched.active_tasks().find(tid);
+				assert(fit != sched.active_tasks().end());
+
+				preassign_task(sched, fit->second);
+				break;
+			}
+
+		case Message::TASK_INLINE:
+			/**
+			 * A worker executed child tasks inline, they were never queued here. Tasks 
+			 * waiting for them (if any) are woken up, the children have no result. 
+			 */
+			{
+				auto desc = msg.get_content_as<std::tuple<Task::TaskIDList>>();
+				sched.tasks_inlined(std::get<0>(desc).size());
+
+				for (Task::TaskID tid : std::get<0>(desc)) {
+					if (sched.tid_used(tid)) { 
+						sched.cmd_queue().push( Event(Event::TASK_COMPLETED, utils::any(std::move(tid))) ); 
+					}
+				}
+				break;
+			}
+
+		case Message::TASK_RESULT:
+			/**
+			 * A worker asks for the result of a completed task which was not handed to it 
+			 * with the wakeup, the (possibly empty) result is sent back with a dedicated tag 
+			 */
+			{
+				Task::TaskID tid = std::get<0>(msg.get_content_as<std::tuple<Task::TaskID>>());
+
+				std::string result = sched.take_result(tid);
+				MPI_Send(const_cast<char*>(result.data()), result.size(), MPI_BYTE, msg.endpoint(), 5, msg.comm()); 
+				break;
+			}
+
+		case Message::TASK_WAIT:
+			/** 
+			 * A worker group is waiting for other tasks (all of them or any of them), the worker 
+			 * is paused waiting to be wake up, therefore we register an event handler to wake up 
+			 * the worker upon completition
+			 */
+			{
+				auto desc = msg.get_content_as<std::tuple<Task::TaskID, Task::TaskIDList, bool>>();
+				
+				Task::TaskID tid = std::get<0>(desc);
+				bool any = std::get<2>(desc);
+
+				LOG(INFO) << "Task '" << tid << "' waiting for " << (any ? "any" : "all") 
+					      << " of tasks: " << utils::join(std::get<1>(desc));
+
+				auto& active_tasks = sched.active_tasks();
+				auto fit = active_tasks.find(tid);
+				assert(fit != active_tasks.end());
+
+				/**
+				 * A task spanning multiple nodes keeps its ranks while suspended, it is 
+				 * resumed as soon as the tasks it waits for complete 
+				 */
+				bool spanned = !fit->second->peers().empty();
+
+				auto wakeup = [&sched, tid, spanned](const Task::TaskID& cur) {
+					auto fit = sched.active_tasks().find(tid);
+					assert(fit != sched.active_tasks().end());
+					fit->second->wakeup() = cur;
+
+					if (spanned) { 
+						resume_task(sched, tid); 
+						return;
+					}
+					sched.wake_task( fit->second );
+				};
+
+				Task::TaskID completed;
+				if (!wait_tasks(sched, std::get<1>(desc), any, completed, wakeup)) {
+					fit->second->wakeup() = completed;
+					resume_task(sched, tid);
+					break;
+				}
+
+				if (spanned) { break; }
+
+				sched.task_suspended(*fit->second);
+
+				// Make the pids available for successive tasks, a queued child is 
+				// preferably started on them 
+				if (!handoff_child(sched, fit->second, std::get<1>(desc))) {
+					sched.release_pids(fit->second->ranks()); 
+				}
+
+				// try to schedule a new task 
+				task_spawn(sched);
+
+				break;
+			}
+
+		case Message::OBJECT_PUT:
+			/**
+			 * A task stored an object in the shared memory of the node, making room for it 
+			 * may evict older objects 
+			 */
+			{
+				auto desc = msg.get_content_as<std::tuple<ObjectID, unsigned long>>();
+				remove_objects( sched.store().insert(std::get<0>(desc), std::get<1>(desc), msg.endpoint()) );
+				break;
+			}
+
+		case Message::OBJECT_ACQUIRE:
+			{
+				sched.store().acquire( std::get<0>(msg.get_content_as<std::tuple<ObjectID>>()) );
+				break;
+			}
+
+		case Message::OBJECT_RELEASE:
+			{
+				remove_objects( sched.store().release(std::get<0>(msg.get_content_as<std::tuple<ObjectID>>())) );
+				break;
+			}
+
+		case Message::STREAM_CREATE:
+			{
+				sched.store().insert_stream(std::get<0>(msg.get_content_as<std::tuple<ObjectID>>()), msg.endpoint());
+				break;
+			}
+
+		case Message::TASK_STEAL:
+			/**
+			 * A peer scheduler has idle ranks, hand over half of the tasks we cannot start
+			 */
+			{
+				unsigned width = std::get<0>(msg.get_content_as<std::tuple<unsigned>>());
+
+				// the thief may shut down before running them 
+				std::vector<TaskInfo> stolen;
+				if (!sched.finalizing()) { stolen = steal_half(sched, width); }
+				LOG(DEBUG) << "Scheduler " << msg.endpoint() << " stole " << stolen.size() << " task(s)";
 
-	void wakeup_group(const Scheduler& sched, const std::vector<int>& ranks, const Task::TaskID& tid);
+				SendChannel()( 
+					Message(Message::TASK_STOLEN, msg.endpoint(), msg.comm(), std::make_tuple(stolen)) 
+				);
+				break;
+			}
 
-	void task_spawn(Scheduler& sched);
+		case Message::TASK_STOLEN:
+			/**
+			 * Reply to a work request: the received tasks keep their original tid. If the 
+			 * victim had no work for us the next request is delayed (exponential backoff)
+			 */
+			{
+				auto stolen = std::get<0>(msg.get_content_as<std::tuple<std::vector<TaskInfo>>>());
+
+				if (stolen.empty()) {
+					sched.steal_delay() = std::min(std::max(2*sched.steal_delay(), MIN_STEAL_DELAY), MAX_STEAL_DELAY);
+					sched.cmd_queue().push( 
+						Event(Event::WORK_STEAL, utils::any(true), 
+							  std::chrono::high_resolution_clock::now() + 
+							  std::chrono::milliseconds(sched.steal_delay())) 
+					);
+					break;
+				}
 
-	template <class Functor>
-	inline void resume_workers(Scheduler& sched, const std::vector<int>& ranks, const Functor& func) {
+				sched.steal_pending() = false;
+				sched.steal_delay() = 0;
 
-		for(int idx : ranks) {
-			kill(sched.pid_list()[idx-1].second, SIGCONT);
-			func(idx);
-		}
+				LOG(INFO) << "Stolen " << stolen.size() << " task(s) from scheduler " << msg.endpoint();
+				for (auto& cur : stolen) { add_task(sched, make_task(cur)); }
+				break;
+			}
 
-	}
+		case Message::SPAN_RESERVE:
+			/**
+			 * Reserves free ranks of this node for a task coordinated by a peer scheduler 
+			 */
+			{
+				auto desc = msg.get_content_as<std::tuple<Task::TaskID, unsigned>>();
+				Task::TaskID tid = std::get<0>(desc);
 
-	/**
-	 * Creates a task and push it into the task queue hosted by the 
-	 * scheduler 
-	 */
-	Task::TaskID create_task(Scheduler& 		sched, 
-							 const std::string& kernel, 
-							 unsigned 			min, 
-							 unsigned 			max) 
-	{
-	
-		Task::TaskID tid = sched.next_tid();
+				// The co-allocation of this node gives way, its ranks serve the request. Its 
+				// own reservation request is still in flight, the grant closes it
+				auto req = sched.span();
+				if (req && !req->yielded && SpanPolicy::yields(sched.sched_rank(), msg.endpoint())) {
+					LOG(DEBUG) << "Co-allocation of task " << *req->task << " yields to scheduler " 
+							   << msg.endpoint();
+					span_abort(sched, req);
+					req->yielded = true;
+				}
 
-		auto task = std::make_shared<Task>(tid, kernel, min, max);
-		sched.enqueue_task( task );
-		
-		LOG(INFO) << "Created Task: " << *task; 
+				unsigned n = std::min(sched.free_ranks().count(), std::get<1>(desc));
 
-		// create an event 
-		sched.cmd_queue().push( Event(Event::TASK_CREATED, utils::any(std::move(tid))) );
+				std::vector<int> ranks;
+				if (n > 0) {
+					ranks = sched.free_ranks().acquire(n);
+					sched.reservations()[tid] = ranks;
+				}
 
-		return tid;
-	}
+				SendChannel()( 
+					Message(Message::SPAN_GRANT, msg.endpoint(), msg.comm(), 
+							std::make_tuple(tid, sched.world_ranks(ranks))) 
+				);
+				break;
+			}
 
-	void resume_task(Scheduler& sched, const Task::TaskID& tid) {
-		auto& t = sched.active_tasks()[tid];
+		case Message::SPAN_GRANT:
+			{
+				auto desc = msg.get_content_as<std::tuple<Task::TaskID, std::vector<int>>>();
+				auto req = sched.span();
+				assert(req && req->task->tid() == std::get<0>(desc));
+
+				const auto& granted = std::get<1>(desc);
+				if (req->yielded) {
+					if (!granted.empty()) {
+						SendChannel()( 
+							Message(Message::SPAN_CANCEL, msg.endpoint(), msg.comm(), 
+									std::make_tuple(req->task->tid())) 
+						);
+					}
+					sched.span().reset();
+					span_retry(sched);
+					break;
+				}
 
-		auto msg = [&](const int& idx) { 
-		MPI_Send(const_cast<Task::TaskID*>(&tid), 1, MPI_UNSIGNED_LONG, 
-			 sched.pid_list()[idx-1].first, 3, sched.node_comm());
-		};
+				if (!granted.empty()) {
+					req->group.insert(req->group.end(), granted.begin(), granted.end());
+					req->peers.push_back(msg.endpoint());
+					req->needed -= granted.size();
+				}
+				span_next(sched);
+				break;
+			}
 
-		resume_workers(sched, t->ranks(), msg);
-	}
+		case Message::SPAN_LAUNCH:
+			/**
+			 * The co-allocation succeeded, the reserved ranks join the group 
+			 */
+			{
+				auto desc = msg.get_content_as<std::tuple<Task::TaskID, std::vector<int>>>();
+				Task::TaskID tid = std::get<0>(desc);
+				const auto& group = std::get<1>(desc);
 
-	/** 
-	 * Handle incoming messages to the scheduler by implementeing their 
-	 * semantic actions 
-	 */
-	bool message_dispatch(Scheduler& sched, const comm::Message& msg) {
+				auto fit = sched.reservations().find(tid);
+				assert(fit != sched.reservations().end());
 
-		using namespace comm;
+				Task t(tid, KernelRegistry::INVALID, group.size(), group.size());
+				sched.active_tasks().insert( 
+					std::make_pair(tid, std::make_shared<LocalTask>(t, fit->second)) 
+				);
+				launch_group(sched, fit->second, group);
 
-		switch(msg.msg_id()) {
+				sched.reservations().erase(fit);
+				break;
+			}
 
-		case Message::TASK_CREATE: 
+		case Message::SPAN_CANCEL:
 			{
+				Task::TaskID tid = std::get<0>(msg.get_content_as<std::tuple<Task::TaskID>>());
 
-				typedef std::tuple<std::string,unsigned,unsigned> ContentType;
-
-				auto content = msg.get_content_as<ContentType>();
+				auto fit = sched.reservations().find(tid);
+				assert(fit != sched.reservations().end());
 
-				Task::TaskID tid = 
-					create_task(sched, std::get<0>(content), 
-								std::get<1>(content), std::get<2>(content)
-							);
+				sched.release_pids(fit->second);
+				sched.reservations().erase(fit);
 
-				MPI_Send(&tid, 1, MPI_UNSIGNED_LONG, msg.endpoint(), 0, msg.comm()); 
+				task_spawn(sched);
 				break;
 			}
 
-		case Message::TASK_COMPLETED:
+		case Message::SPAN_RELEASE:
 			/**
-			 * When we receive a message from the master worker saying that the task is completed 
-			 * we all generate an internal event
+			 * A task spanning multiple nodes completed, its local ranks are free again 
 			 */
-			{	
-				auto desc = msg.get_content_as<std::tuple<Task::TaskID>>();
-				
-				Task::TaskID tid = std::get<0>(desc);
+			{
+				Task::TaskID tid = std::get<0>(msg.get_content_as<std::tuple<Task::TaskID>>());
+
 				auto& active_tasks = sched.active_tasks();
 				auto fit = active_tasks.find(tid);
 				assert(fit != active_tasks.end());
 
-				// Make the pids available for successive tasks 
 				sched.release_pids(fit->second->ranks()); 
-
-				// Remove the task
+				sched.task_executed(*fit->second);
 				active_tasks.erase(fit);
 
-				sched.cmd_queue().push(
-					Event(Event::TASK_COMPLETED, utils::any(std::move(tid))) 
-				);
-
+				task_spawn(sched);
 				break;
 			}
 
-		case Message::TASK_WAIT:
-			/** 
-			 * A worker group is waiting for another task, the worker is paused waiting to be wake
-			 * up, therefore we register an event handler to wake up the worker upon completition
-			 */
+		case Message::SPAN_RESUME:
 			{
 				auto desc = msg.get_content_as<std::tuple<Task::TaskID, Task::TaskID>>();
-				LOG(INFO) << "Task '" << std::get<0>(desc) 
-					      << "' waiting for tasks: " << std::get<1>(desc);
-				
 				Task::TaskID tid = std::get<0>(desc);
 
-				auto& active_tasks = sched.active_tasks();
-				auto fit = active_tasks.find(tid);
-				assert(fit != active_tasks.end());
+				// the group leader runs on the node coordinating the task 
+				sched.active_tasks()[tid]->wakeup() = std::get<1>(desc);
+				resume_task(sched, tid, false);
+				break;
+			}
 
-				if (sched.is_completed(std::get<1>(desc))) {
-					resume_task(sched, tid);
-					break;
-				}
-			
-				// Make the pids available for successive tasks 
-				sched.release_pids(fit->second->ranks()); 
+		case Message::TASK_PLACE:
+			/**
+			 * The global scheduler placed a task on this node 
+			 */
+			{
+				auto desc = msg.get_content_as<TaskInfo>();
 
-				sched.handler().connect(
-						Event::TASK_COMPLETED, 
-						std::function<bool (const Task::TaskID&)>(
-							[&sched, tid](const Task::TaskID& cur) {
-								auto fit = sched.active_tasks().find(tid);
-								assert(fit != sched.active_tasks().end());
-								sched.enqueue_task( fit->second );
-								sched.active_tasks().erase(fit);
-								return true;
-							}
-						),
-						// Filter the particular event 
-						std::function<bool (const Task::TaskID&)>(
-							[=](const Task::TaskID& cur) { 
-								return cur == std::get<1>(desc); 
-							}
-						)
-					);
+				++sched.placed();
+				add_task(sched, make_task(desc));
+				break;
+			}
+
+		case Message::TASK_FORWARD:
+			/**
+			 * A peer scheduler sent us a task reading objects stored by this node 
+			 */
+			{
+				add_task(sched, make_task(msg.get_content_as<TaskInfo>()));
+				break;
+			}
+
+		case Message::LOAD_DELTA:
+			/**
+			 * Change in the load of a node, received by the global scheduler 
+			 */
+			{
+				auto delta = msg.get_content_as<std::tuple<int, int, unsigned>>();
+				apply_load(sched, msg.endpoint(), std::get<0>(delta), std::get<1>(delta), std::get<2>(delta));
+				break;
+			}
+
+		case Message::TASK_REMOTE_COMPLETED:
+			/**
+			 * A task created by this scheduler completed on another node 
+			 */
+			{
+				auto desc = msg.get_content_as<std::tuple<Task::TaskID, std::string>>();
+				Task::TaskID tid = std::get<0>(desc);
 				
-				// try to schedule a new task 
-				task_spawn(sched);
+				bool remote = sched.remote_tasks().complete(tid);
+				assert(remote);
+				(void) remote;
+
+				memoize(sched, tid, std::get<1>(desc));
+				if (!std::get<1>(desc).empty()) { sched.results()[tid] = std::move(std::get<1>(desc)); }
 
+				sched.cmd_queue().push(
+					Event(Event::TASK_COMPLETED, utils::any(std::move(tid))) 
+				);
 				break;
 			}
 
@@ -159,60 +1431,215 @@ namespace {
 			assert(false);
 		}
 
+		report_load(sched);
 		return false;
 	}
 
 	/**
-	 * TaskSpawn takes care of actually activating a task 
+	 * Task bundling: single rank tasks running a short kernel are dispatched to a worker 
+	 * together with other queued tasks running the same kernel, the worker executes them 
+	 * back-to-back without forming a group for each of them. Gathers the tasks to be 
+	 * bundled with t (t comes first) and removes them from the ready queue. The size of 
+	 * the bundle follows the observed runtime of the kernel and the queued tasks are 
+	 * spread over the free ranks.
+	 */
+	std::vector<TaskPtr> gather_bundle(Scheduler& sched, const TaskPtr& t) {
+
+		std::vector<TaskPtr> bundle(1, t);
+		if (!sched.bundling() || t->min() != 1 || std::dynamic_pointer_cast<LocalTask>(t) || 
+			!(sched.kernels()[t->kernel()].flags & KernelDesc::BUNDLE)) 
+		{ 
+			return bundle; 
+		}
+
+		unsigned size = sched.kernel_stats().bundle_size(t->kernel(), BUNDLE_TARGET_SECS, MAX_BUNDLE_SIZE);
+		if (size == 1) { return bundle; }
+
+		auto& queue = sched.ready_tasks();
+		auto matches = [&](const TaskPtr& cur) { 
+			return cur->min() == 1 && cur->kernel() == t->kernel() && !std::dynamic_pointer_cast<LocalTask>(cur) && 
+				   starts_alone(sched, *cur); 
+		};
+
+		// the rank of t has been acquired already 
+		unsigned free = sched.free_ranks().count() + 1;
+		size_t queued = std::count_if(queue.begin(), queue.end(), matches);
+		size = std::min<size_t>(size, (queued + free) / free);
+
+		for (auto it = queue.begin(); it != queue.end() && bundle.size() < size; ) {
+			if (!matches(*it)) { 
+				++it; 
+				continue; 
+			}
+			bundle.push_back(*it);
+			it = queue.erase(it);
+		}
+		return bundle;
+	}
+
+	/**
+	 * Sends a bundle of tasks to the worker of rank: the id of the kernel, the tids of the 
+	 * tasks and the sizes of their arguments followed by the (inline) arguments of all the 
+	 * tasks. 
+	 * The first task of the bundle holds the rank, the others are active without ranks.
+	 */
+	void launch_bundle(Scheduler& sched, const std::vector<TaskPtr>& bundle, int rank) {
+
+		LOG(DEBUG) << "Bundling " << bundle.size() << " tasks running '" << sched.kernels()[bundle.front()->kernel()].name 
+				   << "' on rank " << rank;
+
+		std::vector<unsigned long> desc(1, bundle.front()->kernel());
+		std::string args;
+
+		for (const auto& t : bundle) { desc.push_back(t->tid()); }
+
+		// shared arguments are sent inline, the worker does not map them 
+		for (const auto& t : bundle) { 
+			std::string cur = Payload::is_shared(t->args()) ? Payload::make_inline(t->args()) : t->args();
+			desc.push_back(cur.size()); 
+			args += cur;
+		}
+
+		for (size_t idx=0; idx<bundle.size(); ++idx) {
+			sched.active_tasks().insert( 
+				std::make_pair(bundle[idx]->tid(), 
+							   std::make_shared<LocalTask>(*bundle[idx], LocalTask::RankList(idx ? 0 : 1, rank))) 
+			);
+		}
+
+		auto msg = [&](const int& idx) { 
+			MPI_Send(&desc.front(), desc.size(), MPI_UNSIGNED_LONG, sched.pid_list()[idx-1].first, 2, sched.node_comm());
+			if (!args.empty()) {
+				MPI_Send(&args[0], args.size(), MPI_BYTE, sched.pid_list()[idx-1].first, 2, sched.node_comm());
+			}
+		};
+
+		resume_workers(sched, std::vector<int>(1, rank), msg);
+	}
+
+	/**
+	 * TaskSpawn takes care of actually activating a task, returns false if no 
+	 * task could be activated 
 	 */
-	void task_spawn(Scheduler& sched) {
+	bool task_spawn(Scheduler& sched) {
 		
 		LOG(INFO) << "try spawn";
-		auto t = sched.next_task();
-
-		if (!t) { return; }
 
-		if (LocalTaskPtr lt = std::dynamic_pointer_cast<LocalTask>(t)) {
-			LOG(DEBUG) << "Resuming task: " << *t;
-			sched.active_tasks().insert( {lt->tid(), lt} );
+		// Woken tasks which got back all their ranks have priority over new tasks 
+		bool resumed = false;
+		while (LocalTaskPtr lt = sched.next_resumable()) {
+			LOG(DEBUG) << "Resuming task: " << *lt;
 			resume_task(sched, lt->tid());
-			return ;
+			resumed = true;
+		}
+
+		// tasks connected by streams only start once all of them fit 
+		std::vector<TaskPtr> gang;
+		auto t = sched.next_task([&](const TaskPtr& cur) { 
+			gang = stream_gang(sched, cur);
+
+			unsigned min = 0;
+			for (const auto& member : gang) { min += member->min(); }
+			return !gang.empty() && min <= sched.free_ranks().count();
+		});
+
+		if (!t) { 
+			if (!resumed && !start_span(sched)) { try_steal(sched); }
+			return resumed; 
 		}
 
 		LOG(DEBUG) << "Spawning task: " << *t;
 
+		if (gang.size() > 1) {
+			LOG(DEBUG) << "Starting " << gang.size() << " tasks connected by streams";
+
+			auto& queue = sched.ready_tasks();
+			for (const auto& cur : gang) { 
+				queue.remove(cur); 
+				for (const auto& in : cur->inputs()) { sched.store().start_stream(in.id); }
+			}
+
+			for (const auto& cur : gang) {
+				std::vector<int> ranks = sched.acquire_ranks(cur->min(), input_rank(sched, *cur));
+				launch_task(sched, cur, ranks, sched.world_ranks(ranks));
+			}
+			return true;
+		}
+
 		unsigned min = t->min();
 
-		assert(sched.free_ranks().size() >= min);
+		assert(sched.free_ranks().count() >= min);
 
-		std::vector<int> ranks(min);
-		auto it = sched.free_ranks().begin();
+		// the group is placed around the rank which produced most of its inputs 
+		std::vector<int> ranks = sched.acquire_ranks(min, input_rank(sched, *t));
 
-		for (int i=0; i<min; ++i)
-			ranks[i] = *(it++);
+		std::vector<TaskPtr> bundle = gather_bundle(sched, t);
+		if (bundle.size() > 1) {
+			launch_bundle(sched, bundle, ranks.front());
+			return true;
+		}
 
-		for (auto rank : ranks) { sched.free_ranks().erase(rank); }
+		launch_task(sched, t, ranks, sched.world_ranks(ranks));
+		return true;
+	}
 
-		// Store the task as an Active task
-		sched.active_tasks().insert( std::make_pair(t->tid(), std::make_shared<LocalTask>(*t, ranks)) );
+	/**
+	 * Closes the run on the event thread, which owns the communication with the peer 
+	 * schedulers. Idle nodes keep serving (and stealing) tasks until every node reached 
+	 * finalize (phases 0-1); then stealing stops and each node waits for the reply to 
+	 * its pending work request. A second barrier (phases 2-3) makes sure that every 
+	 * request in flight was answered before the schedulers shut down.
+	 */
+	void finalize_step(Scheduler& sched, unsigned phase) {
 
-		auto msg = [&](const int& idx) { 
-			MPI_Send(const_cast<int*>(&ranks.front()), ranks.size(), 
-					 MPI_INT, sched.pid_list()[idx-1].first, 1, sched.node_comm()
+		auto later = [&](unsigned next) {
+			sched.cmd_queue().push( 
+				Event(Event::FINALIZE, utils::any(unsigned(next)), 
+					  std::chrono::high_resolution_clock::now() + 
+					  std::chrono::milliseconds(FINALIZE_POLL_DELAY)) 
 			);
 		};
 
-		resume_workers(sched, ranks, msg);
+		int done = 0;
+		switch (phase) {
+		case 0:
+		case 2:
+			// the work request in flight (or the delayed one) goes first 
+			if (phase == 2 && sched.steal_pending()) { 
+				later(2); 
+				break; 
+			}
 
-		// Send the TID 
-		MPI_Send(const_cast<Task::TaskID*>(&t->tid()), 1, MPI_UNSIGNED_LONG, 
-				 ranks.front(), 0, sched.node_comm());
+			MPI_Ibarrier(sched.sched_comm(), &sched.finalize_request());
+			later(phase+1);
+			break;
 
-		// Send the name of the function to be invoked 
-		MPI_Send(const_cast<char*>(t->kernel().c_str()), t->kernel().length()+1, MPI_CHAR,
-				 ranks.front(), 0, sched.node_comm());
-	}
+		case 1:
+			MPI_Test(&sched.finalize_request(), &done, MPI_STATUS_IGNORE);
+			if (!done) { 
+				later(1); 
+				break; 
+			}
+
+			LOG(DEBUG) << "Every node reached finalize, work stealing stopped";
+			sched.finalizing() = true;
+			finalize_step(sched, 2);
+			break;
 
+		case 3:
+			MPI_Test(&sched.finalize_request(), &done, MPI_STATUS_IGNORE);
+			if (!done) { 
+				later(3); 
+				break; 
+			}
+
+			sched.cmd_queue().push( Event(Event::SHUTDOWN, true) );
+			break;
+
+		default:
+			assert(false);
+		}
+	}
 
 } // end anonymous namespace 
 
@@ -230,7 +1657,27 @@ void Scheduler::do_work() {
 	m_handler.connect(
 			Event::TASK_CREATED, 
 			std::function<bool (const Task::TaskID&)>(
-				[&](const Task::TaskID& cur) { task_spawn(*this); return false; }
+				[&](const Task::TaskID&) { task_spawn(*this); report_load(*this); return false; }
+			)
+		);
+
+	// connect handler for batches of tasks, activates as many tasks as possible 
+	m_handler.connect(
+			Event::TASKS_CREATED, 
+			std::function<bool (const Task::TaskID&, const unsigned&)>(
+				[&](const Task::TaskID&, const unsigned&) { 
+					while (task_spawn(*this)) ;
+					report_load(*this); 
+					return false; 
+				}
+			)
+		);
+
+	// connect handler releasing the tasks depending on the completed one 
+	m_handler.connect(
+			Event::TASK_COMPLETED, 
+			std::function<bool (const Task::TaskID&)>(
+				[&](const Task::TaskID& cur) { release_successors(*this, cur); return false; }
 			)
 		);
 
@@ -238,60 +1685,184 @@ void Scheduler::do_work() {
 	m_handler.connect(
 			Event::TASK_COMPLETED, 
 			std::function<bool (const Task::TaskID&)>(
-				[&](const Task::TaskID& cur) { task_spawn(*this); return false; }
+				[&](const Task::TaskID&) { task_spawn(*this); report_load(*this); return false; }
+			)
+		);
+
+	// connect handler for the delayed work requests 
+	m_handler.connect(
+			Event::WORK_STEAL, 
+			std::function<bool (const bool&)>(
+				[&](const bool&) { m_steal_pending = false; try_steal(*this); return false; }
+			)
+		);
+
+	// connect handler for the retry of co-allocations which failed 
+	m_handler.connect(
+			Event::SPAN_RETRY, 
+			std::function<bool (const bool&)>(
+				[&](const bool&) { task_spawn(*this); return false; }
+			)
+		);
+
+	// connect handler for the shutdown of the schedulers 
+	m_handler.connect(
+			Event::FINALIZE, 
+			std::function<bool (const unsigned&)>(
+				[&](const unsigned& phase) { finalize_step(*this, phase); return false; }
 			)
 		);
 
+	std::vector<MPI_Comm> comms({node_comm()});
+	if (sched_size() > 1) { comms.push_back(m_sched_comm); }
+
 	m_handler.queue().push( 
-		Event(Event::RECV_CHN_PROBE, 
-			  utils::any(10ul, std::vector<MPI_Comm>({node_comm()}))) 
+		Event(Event::RECV_CHN_PROBE, utils::any(10ul, std::move(comms))) 
 		);
 
+	// Initial report of the free ranks of this node to the global scheduler 
+	{
+		auto lock = m_handler.lock();
+		report_load(*this);
+	}
+
 	// Makes sure that all the handler are attached before the workers 
 	MPI_Barrier(MPI_COMM_WORLD);
 }
 
-Task::TaskID Scheduler::spawn(const std::string& kernel, unsigned min, unsigned max) {
-	return create_task(*this, kernel, min, max);
+Task::TaskID Scheduler::spawn(const KernelRegistry::KernelID& 	kernel, 
+							  unsigned 					min, 
+							  unsigned 					max, 
+							  const Task::TaskIDList& 	deps,
+							  const std::string& 		args,
+							  const Task::InputList& 	inputs,
+							  const Task::FileList& 	files) 
+{
+	// large arguments are written to shared memory before taking the lock 
+	std::string payload = Payload::encode(args);
+
+	// the task queues are shared with the event handler thread 
+	auto lock = m_handler.lock();
+
+	if (global_tier() && sched_rank() == 0) { 
+		return submit_task(*this, kernel, min, max, deps, payload, inputs, files); 
+	}
+	return create_task(*this, kernel, min, max, deps, payload, inputs, files);
 }
 
-void Scheduler::wait_for(const Task::TaskID& tid) {
+TaskRange Scheduler::spawn_n(const KernelRegistry::KernelID& kernel, unsigned count, unsigned min, unsigned max) {
+
+	if (count == 0) { return TaskRange{0, 0}; }
 
-	// need to acquire lock on the event handler 
-	if (is_completed(tid)) { return; }
+	auto lock = m_handler.lock();
+
+	if (global_tier() && sched_rank() == 0) { 
+		// tasks are placed one by one on the nodes selected by the global scheduler 
+		TaskRange range = { next_tids(count), count };
+		for (unsigned idx=0; idx<count; ++idx) {
+			auto task = std::make_shared<Task>(range[idx], kernel, min, max);
+			if (known_kernel(*this, task)) { dispatch_task(*this, task); }
+		}
+		return range;
+	}
+	return create_tasks(*this, kernel, count, min, max);
+}
+
+Task::TaskID Scheduler::wait(const Task::TaskIDList& tids, bool any) {
 
 	std::mutex m;
 	std::condition_variable cond_var;
+	bool done = false;
+	Task::TaskID completed;
 
-	m_handler.connect(
-			Event::TASK_COMPLETED, 
-			std::function<bool (const Task::TaskID&)>(
-				[&](const Task::TaskID& cur) { 
-					cond_var.notify_one();
-					return true;
-				}
-			),
-			// Filter the particular event 
-			std::function<bool (const Task::TaskID&)>(
-				[&](const Task::TaskID& cur) { return cur == tid; }
-			)
-		);
+	{
+		auto hlock = m_handler.lock();
+
+		auto wakeup = [&](const Task::TaskID& cur) { 
+			std::lock_guard<std::mutex> lock(m);
+			completed = cur;
+			done = true;
+			cond_var.notify_one();
+		};
+
+		if (!wait_tasks(*this, tids, any, completed, wakeup)) { return completed; }
+	}
 	
 	std::unique_lock<std::mutex> lock(m);
-	cond_var.wait(lock);
+	cond_var.wait(lock, [&]() { return done; });
+
+	return completed;
+}
+
+void Scheduler::set_result(const std::string&) {
+	LOG(ERROR) << "The main program is not a task, its result is discarded";
+}
+
+std::string Scheduler::result(const Task::TaskID& tid) {
+
+	std::string encoded;
+	{
+		auto lock = m_handler.lock();
+		encoded = take_result(tid);
+	}
+
+	std::string result = Payload(encoded).str();
+	Payload::release(encoded);
+	return result;
+}
+
+void Scheduler::store_insert(const ObjectRef& ref) {
+	auto lock = m_handler.lock();
+	// the main program runs on rank 0 of the node 
+	remove_objects( m_store.insert(ref.id, ref.size, 0) );
+}
+
+void Scheduler::store_acquire(const ObjectID& id) {
+	auto lock = m_handler.lock();
+	m_store.acquire(id);
+}
+
+void Scheduler::store_release(const ObjectID& id) {
+	auto lock = m_handler.lock();
+	remove_objects( m_store.release(id) );
+}
 
+void Scheduler::stream_insert(const ObjectID& id) {
+	auto lock = m_handler.lock();
+	m_store.insert_stream(id, 0);
 }
 
 void Scheduler::finalize() { 
 
+	// the event thread stops once every node reached finalize (see finalize_step) 
+	cmd_queue().push( Event(Event::FINALIZE, utils::any(0u)) );
+
+	join();
+
+	LOG(INFO) << "Scheduler " << sched_rank() << " executed " << m_executed << " task(s), "
+			  << "busy for " << m_busy << " rank-seconds, " 
+			  << m_inlined << " task(s) executed inline by the workers, " 
+			  << m_memo.hits() << " completed from the results cache";
+
 	for(auto& idxs : pid_list()) {
 		kill(idxs.second, SIGCONT);
 		MPI_Send(NULL, 0, MPI_BYTE, idxs.first, 0, node_comm());
 	}
 
-	cmd_queue().push( Event(Event::SHUTDOWN,true)  );
+	// the objects do not outlive the run 
+	LOG(INFO) << "Removing " << m_store.count() << " object(s) of " << m_store.used()/1024 << " KiB from the store";
+	remove_objects( m_store.clear() );
 
-	join();
+	// rings whose reader never ran or never went away 
+	for (auto id : m_store.clear_streams()) { utils::shm_remove(Stream::name(id)); }
+
+	LOG(INFO) << "Removing " << m_staging.used()/1024 << " KiB of staged files";
+	m_staging.clear();
+
+	// results nobody asked for, the large ones live in shared memory 
+	LOG(INFO) << "Dropping " << m_results.size() << " result(s) never handed out";
+	for (const auto& cur : m_results) { Payload::release(cur.second); }
+	m_results.clear();
 
 	MPI_Finalize();
 }
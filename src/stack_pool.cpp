@@ -0,0 +1,142 @@
+
+#include "stack_pool.h"
+
+#include "utils/logging.h"
+
+#include <cassert>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace mpits {
+
+namespace {
+
+	size_t page_size() {
+		static size_t size = sysconf(_SC_PAGESIZE);
+		return size;
+	}
+
+} // end anonymous namespace
+
+const size_t StackPool::MIN_STACK_SIZE;
+const size_t StackPool::HOT_SIZE;
+
+StackPool::StackPool(size_t default_size, size_t max_cached) : 
+	m_default_size(size_class(default_size)), m_max_cached(max_cached), m_mapped(0) { }
+
+StackPool::~StackPool() {
+	for (unsigned idx=0; idx<m_free.size(); ++idx) {
+		for (void* sp : m_free[idx]) { unmap(sp, size_t(1) << idx); }
+	}
+}
+
+size_t StackPool::size_class(size_t size) {
+	size_t cls = MIN_STACK_SIZE < page_size() ? page_size() : MIN_STACK_SIZE;
+	while (cls < size) { cls <<= 1; }
+	return cls;
+}
+
+unsigned StackPool::class_index(size_t size) {
+	assert(size == size_class(size) && "Not a size class");
+	return __builtin_ctzll(size);
+}
+
+void* StackPool::allocate(size_t size) {
+
+	size = size_class(size);
+	unsigned idx = class_index(size);
+
+	if (idx < m_free.size() && !m_free[idx].empty()) {
+		void* sp = m_free[idx].back();
+		m_free[idx].pop_back();
+		return sp;
+	}
+
+	// the guard page sits below the stack, which grows downwards
+	size_t guard = page_size();
+	void* base = mmap(nullptr, size + guard, PROT_READ | PROT_WRITE, 
+					  MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if (base == MAP_FAILED) {
+		LOG(ERROR) << "Cannot map a stack of " << size << " bytes";
+		::abort();
+	}
+
+	mprotect(base, guard, PROT_NONE);
+	++m_mapped;
+
+	return static_cast<char*>(base) + guard + size;
+}
+
+void StackPool::deallocate(void* sp, size_t size) {
+
+	size = size_class(size);
+	unsigned idx = class_index(size);
+
+	if (idx >= m_free.size()) { m_free.resize(idx+1); }
+
+	if (m_free[idx].size() >= m_max_cached) { 
+		unmap(sp, size); 
+		return;
+	}
+
+	// the top of the stack is the part the next task touches first 
+	trim(sp, size, static_cast<char*>(sp) - HOT_SIZE);
+	m_free[idx].push_back(sp);
+}
+
+bool StackPool::reserve(size_t size) {
+
+	size = size_class(size);
+	unsigned idx = class_index(size);
+
+	if (idx < m_free.size() && !m_free[idx].empty()) { return false; }
+
+	void* sp = allocate(size);
+	std::memset(static_cast<char*>(sp) - HOT_SIZE, 0, HOT_SIZE);
+	deallocate(sp, size);
+	return true;
+}
+
+size_t StackPool::trim(void* sp, size_t size, void* low) {
+
+	char* bottom = static_cast<char*>(sp) - size;
+
+	// round down to the page containing low, which may be in use
+	uintptr_t end = reinterpret_cast<uintptr_t>(low) & ~(page_size()-1);
+	if (end <= reinterpret_cast<uintptr_t>(bottom)) { return 0; }
+
+	size_t len = end - reinterpret_cast<uintptr_t>(bottom);
+	madvise(bottom, len, MADV_DONTNEED);
+	return len;
+}
+
+size_t StackPool::used(void* sp, size_t size) {
+
+	char* bottom = static_cast<char*>(sp) - size;
+	size_t pages = size / page_size();
+
+	std::vector<unsigned char> resident(pages);
+	if (mincore(bottom, size, &resident.front()) != 0) { return size; }
+
+	for (size_t idx=0; idx<pages; ++idx) {
+		if (resident[idx] & 1) { return size - idx*page_size(); }
+	}
+	return 0;
+}
+
+size_t StackPool::cached() const {
+	size_t n = 0;
+	for (const FreeList& list : m_free) { n += list.size(); }
+	return n;
+}
+
+void StackPool::unmap(void* sp, size_t size) {
+	size_t guard = page_size();
+	munmap(static_cast<char*>(sp) - size - guard, size + guard);
+}
+
+} // end namespace mpits
@@ -0,0 +1,213 @@
+#include "staging.h"
+
+#include "utils/hash.h"
+#include "utils/logging.h"
+
+#include <cstdio>
+#include <sstream>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Size of the buffer used to copy the files
+#define STAGING_BUFFER_SIZE (1ul << 20)
+
+namespace mpits {
+
+namespace {
+
+	unsigned long& job_token() {
+		static unsigned long token = getpid();
+		return token;
+	}
+
+	// True if the staged copy exists and was taken from the current version of file
+	bool up_to_date(const std::string& file, const std::string& staged) {
+		struct stat src, dst;
+		return stat(staged.c_str(), &dst) == 0 && stat(file.c_str(), &src) == 0 && 
+			   src.st_size == dst.st_size && 
+			   src.st_mtim.tv_sec == dst.st_mtim.tv_sec && src.st_mtim.tv_nsec == dst.st_mtim.tv_nsec;
+	}
+
+} // end anonymous namespace
+
+const std::string& StagingCache::directory() {
+	static std::string dir = getenv("MPITS_STAGING_DIR") ? getenv("MPITS_STAGING_DIR") : "/dev/shm";
+	return dir;
+}
+
+unsigned long StagingCache::job() { return job_token(); }
+
+void StagingCache::set_job(unsigned long token) { job_token() = token; }
+
+ObjectID StagingCache::file_id(const std::string& file) {
+	// 0 is the null object
+	ObjectID id = utils::fnv1a(file);
+	return id ? id : 1;
+}
+
+std::string StagingCache::path(const ObjectID& id) {
+	std::ostringstream ss;
+	ss << directory() << "/mpits.stage." << std::hex << job() << "." << id;
+	return ss.str();
+}
+
+std::string StagingCache::path(const std::string& file) { return path(file_id(file)); }
+
+std::string StagingCache::lookup(const std::string& file) {
+	std::string staged = path(file);
+	return up_to_date(file, staged) ? staged : file;
+}
+
+bool StagingCache::copy(const std::string& file, const std::string& path, size_t& size) {
+
+	if (up_to_date(file, path)) {
+		struct stat st;
+		stat(path.c_str(), &st);
+		size = st.st_size;
+		return true;
+	}
+
+	int in = open(file.c_str(), O_RDONLY);
+	if (in < 0) { return false; }
+
+	struct stat src;
+	if (fstat(in, &src) != 0) {
+		close(in);
+		return false;
+	}
+
+	// the temporary file is private to this process 
+	std::ostringstream ss;
+	ss << path << "." << getpid() << ".tmp";
+	std::string tmp = ss.str();
+
+	int out = open(tmp.c_str(), O_CREAT | O_TRUNC | O_WRONLY, 0644);
+	if (out < 0) {
+		close(in);
+		return false;
+	}
+
+	std::vector<char> buf(STAGING_BUFFER_SIZE);
+	bool ok = true;
+	size = 0;
+	for (;;) {
+		ssize_t count = read(in, &buf.front(), buf.size());
+		if (count == 0) { break; }
+		if (count < 0 || write(out, &buf.front(), count) != count) {
+			ok = false;
+			break;
+		}
+		size += count;
+	}
+	close(in);
+
+	// the copy carries the modification time of the version it was taken from 
+	struct timespec times[2] = { src.st_atim, src.st_mtim };
+	ok = ok && futimens(out, times) == 0;
+	ok = close(out) == 0 && ok;
+
+	if (!ok || rename(tmp.c_str(), path.c_str()) != 0) {
+		unlink(tmp.c_str());
+		return false;
+	}
+	return true;
+}
+
+StagingCache::StagingCache(size_t capacity) :
+	m_index(capacity), m_stop(false), m_thr(&StagingCache::run, this) { }
+
+StagingCache::~StagingCache() {
+	if (m_thr.joinable()) { clear(); }
+}
+
+void StagingCache::prefetch(const std::string& file) {
+
+	ObjectID id = file_id(file);
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_index.acquire(id);
+
+	if (m_index.contains(id) || !m_pending.insert(id).second) { return; }
+
+	m_queue.push_back(file);
+	m_cond.notify_one();
+}
+
+size_t StagingCache::release(const std::string& file) {
+
+	ObjectStore::ObjectList evicted;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		evicted = m_index.release(file_id(file));
+	}
+	remove(evicted);
+	return evicted.size();
+}
+
+bool StagingCache::staged(const std::string& file) const {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_index.contains(file_id(file));
+}
+
+size_t StagingCache::used() const {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_index.used();
+}
+
+void StagingCache::clear() {
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+		m_cond.notify_one();
+	}
+	if (m_thr.joinable()) { m_thr.join(); }
+
+	ObjectStore::ObjectList staged;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		staged = m_index.clear();
+		m_queue.clear();
+		m_pending.clear();
+	}
+	remove(staged);
+}
+
+void StagingCache::run() {
+
+	for (;;) {
+		std::string file;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_cond.wait(lock, [&]() { return m_stop || !m_queue.empty(); });
+			if (m_stop) { return; }
+
+			file = std::move(m_queue.front());
+			m_queue.pop_front();
+		}
+
+		ObjectID id = file_id(file);
+
+		size_t size = 0;
+		bool ok = copy(file, path(id), size);
+		if (!ok) { LOG(WARNING) << "Cannot stage file " << file; }
+
+		ObjectStore::ObjectList evicted;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_pending.erase(id);
+			if (ok) { evicted = m_index.insert(id, size); }
+		}
+		remove(evicted);
+
+		LOG(DEBUG) << "Staged file " << file << " (" << size << " bytes), evicted " << evicted.size();
+	}
+}
+
+void StagingCache::remove(const ObjectStore::ObjectList& ids) {
+	for (const ObjectID& id : ids) { unlink(path(id).c_str()); }
+}
+
+} // end namespace mpits
@@ -0,0 +1,195 @@
+#include "stream.h"
+
+#include "utils/logging.h"
+#include "utils/shm.h"
+
+#include <cassert>
+#include <chrono>
+#include <sstream>
+#include <thread>
+
+#include <sched.h>
+
+// Longest sleep (usecs) of an endpoint waiting for the other one
+#define MAX_STREAM_BACKOFF 1000u
+
+namespace mpits {
+
+/**
+ * Shared state of the ring, the counters sit on separate cache lines. Positions grow
+ * monotonically, the ring offset is the position modulo the capacity.
+ */
+struct Stream::Header {
+	uint64_t 	head; 			// bytes written by the writer
+	char 		pad0[56];
+	uint64_t 	tail; 			// bytes consumed by the reader
+	char 		pad1[56];
+	uint32_t 	writer_closed;
+	uint32_t 	reader_closed;
+	char 		pad2[56];
+};
+
+namespace {
+
+	const size_t CHUNK_HEADER = sizeof(uint64_t);
+
+	// Bytes taken by a chunk of size bytes, chunks start at 8 bytes boundaries
+	uint64_t record_size(size_t size) {
+		return CHUNK_HEADER + ((size + 7) & ~uint64_t(7));
+	}
+
+	/**
+	 * Spins yielding the cpu for a while, then sleeps doubling the delay up to
+	 * MAX_STREAM_BACKOFF usecs
+	 */
+	struct Backoff {
+		unsigned spins;
+		unsigned delay;
+
+		Backoff() : spins(0), delay(1) { }
+
+		void wait() {
+			if (spins < 64) {
+				++spins;
+				sched_yield();
+				return;
+			}
+			std::this_thread::sleep_for(std::chrono::microseconds(delay));
+			delay = std::min(2*delay, MAX_STREAM_BACKOFF);
+		}
+	};
+
+} // end anonymous namespace
+
+std::string Stream::name(const ObjectID& id) {
+	std::ostringstream ss;
+	ss << "/mpits.stream." << std::hex << id;
+	return ss.str();
+}
+
+StreamRef Stream::create(size_t capacity, unsigned node) {
+
+	size_t size = 64;
+	while (size < capacity) { size <<= 1; }
+
+	StreamRef ref = { ObjectStore::next_id(node), size };
+	if (!utils::shm_create(name(ref.id), nullptr, sizeof(Header) + size)) {
+		LOG(ERROR) << "Cannot create a stream of " << size << " bytes";
+		return StreamRef{0, 0};
+	}
+	return ref;
+}
+
+Stream::Stream(const StreamRef& ref, const Endpoint& endpoint) :
+	m_ref(ref), m_endpoint(endpoint), m_header(nullptr), m_ring(nullptr), m_closed(false)
+{
+	if (ref.id == 0) { return; }
+
+	void* addr = utils::shm_map(name(ref.id), sizeof(Header) + ref.capacity, true);
+	if (!addr) { return; }
+
+	m_header = static_cast<Header*>(addr);
+	m_ring = static_cast<char*>(addr) + sizeof(Header);
+}
+
+Stream::~Stream() {
+	if (!valid()) { return; }
+
+	close();
+	if (m_endpoint == READER) { utils::shm_remove(name(m_ref.id)); }
+
+	munmap(m_header, sizeof(Header) + m_ref.capacity);
+}
+
+void Stream::copy_in(uint64_t pos, const void* data, size_t size) {
+	size_t off = pos & (m_ref.capacity-1);
+	size_t first = std::min(size, m_ref.capacity - off);
+
+	std::memcpy(m_ring + off, data, first);
+	std::memcpy(m_ring, static_cast<const char*>(data) + first, size - first);
+}
+
+void Stream::copy_out(uint64_t pos, void* data, size_t size) const {
+	size_t off = pos & (m_ref.capacity-1);
+	size_t first = std::min(size, m_ref.capacity - off);
+
+	std::memcpy(data, m_ring + off, first);
+	std::memcpy(static_cast<char*>(data) + first, m_ring, size - first);
+}
+
+bool Stream::try_write(const void* data, size_t size) {
+
+	assert(valid() && m_endpoint == WRITER && !m_closed);
+
+	if (record_size(size) > m_ref.capacity) { return false; }
+
+	if (__atomic_load_n(&m_header->reader_closed, __ATOMIC_ACQUIRE)) { return false; }
+
+	uint64_t head = m_header->head;
+	uint64_t tail = __atomic_load_n(&m_header->tail, __ATOMIC_ACQUIRE);
+	if (m_ref.capacity - (head - tail) < record_size(size)) { return false; }
+
+	uint64_t len = size;
+	copy_in(head, &len, CHUNK_HEADER);
+	copy_in(head + CHUNK_HEADER, data, size);
+
+	__atomic_store_n(&m_header->head, head + record_size(size), __ATOMIC_RELEASE);
+	return true;
+}
+
+bool Stream::write(const void* data, size_t size) {
+
+	// the reader could never make room for it 
+	if (record_size(size) > m_ref.capacity) { return false; }
+
+	Backoff backoff;
+	while (!try_write(data, size)) {
+		if (__atomic_load_n(&m_header->reader_closed, __ATOMIC_ACQUIRE)) { return false; }
+		backoff.wait();
+	}
+	return true;
+}
+
+bool Stream::try_read(std::string& chunk) {
+
+	assert(valid() && m_endpoint == READER && !m_closed);
+
+	uint64_t tail = m_header->tail;
+	uint64_t head = __atomic_load_n(&m_header->head, __ATOMIC_ACQUIRE);
+	if (head == tail) { return false; }
+
+	uint64_t len;
+	copy_out(tail, &len, CHUNK_HEADER);
+
+	chunk.resize(len);
+	copy_out(tail + CHUNK_HEADER, &chunk[0], len);
+
+	__atomic_store_n(&m_header->tail, tail + record_size(len), __ATOMIC_RELEASE);
+	return true;
+}
+
+bool Stream::read(std::string& chunk) {
+
+	Backoff backoff;
+	while (!try_read(chunk)) {
+		// the last chunks may have been written right before the stream was closed
+		if (__atomic_load_n(&m_header->writer_closed, __ATOMIC_ACQUIRE)) { return try_read(chunk); }
+		backoff.wait();
+	}
+	return true;
+}
+
+bool Stream::eof() const {
+	return __atomic_load_n(&m_header->writer_closed, __ATOMIC_ACQUIRE) &&
+		   __atomic_load_n(&m_header->head, __ATOMIC_ACQUIRE) == m_header->tail;
+}
+
+void Stream::close() {
+	if (!valid() || m_closed) { return; }
+
+	uint32_t* flag = m_endpoint == WRITER ? &m_header->writer_closed : &m_header->reader_closed;
+	__atomic_store_n(flag, 1u, __ATOMIC_RELEASE);
+	m_closed = true;
+}
+
+} // end namespace mpits
@@ -8,8 +8,11 @@
 #include "comm/init.h"
 
 #include "utils/logging.h"
+#include "utils/shm.h"
 #include "utils/string.h"
 
+#include <unistd.h>
+
 namespace mpits {
 
 	Role& get_role(std::unique_ptr<Role>&& role=std::unique_ptr<Role>()) {
@@ -29,6 +32,11 @@ namespace mpits {
 		MPI_Comm_rank(MPI_COMM_WORLD, &rank);
 		MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
 
+		// the files staged by this run are named after world rank 0 
+		unsigned long job = getpid();
+		MPI_Bcast(&job, 1, MPI_UNSIGNED_LONG, 0, MPI_COMM_WORLD);
+		StagingCache::set_job(job);
+
 		auto& role = get_role( assign_roles(nprocs) );
 		role.do_work();
 		
@@ -37,20 +45,150 @@ namespace mpits {
 		}
 	}
 
-	Task::TaskID spawn(const std::string& kernel, unsigned min, unsigned max) {
+	namespace {
+
+		// Kernels are looked up once, tasks running unknown kernels are dropped by the scheduler 
+		KernelRegistry::KernelID kernel_id(const Role& r, const std::string& kernel) {
+			auto id = r.kernels().id(kernel);
+			if (id == KernelRegistry::INVALID) { LOG(ERROR) << "Kernel '" << kernel << "' not registered"; }
+			return id;
+		}
+
+	} // end anonymous namespace
+
+	Task::TaskID spawn(const std::string& 		kernel, 
+					   unsigned 				min, 
+					   unsigned 				max, 
+					   const Task::TaskIDList& 	deps) 
+	{
+		auto& r = get_role();
+		return r.spawn(kernel_id(r, kernel), min, max, deps, std::string(), Task::InputList(), Task::FileList());
+
+	}
+
+	Task::TaskID spawn_packed(const std::string& 		kernel, 
+							  unsigned 					min, 
+							  unsigned 					max, 
+							  const std::string& 		args, 
+							  const Task::TaskIDList& 	deps,
+							  const Task::InputList& 	inputs,
+							  const Task::FileList& 	files) 
+	{
+		auto& r = get_role();
+		return r.spawn(kernel_id(r, kernel), min, max, deps, args, inputs, files);
+
+	}
+
+	std::string staged_path(const std::string& file) { return StagingCache::lookup(file); }
+
+	namespace detail {
+
+		KernelRegistry::KernelID kernel_id(const void* fn) {
+
+			auto id = get_role().kernels().fn_id(fn);
+			assert(id != KernelRegistry::INVALID && "Kernel not registered, use MPITS_KERNEL");
+			return id;
+		}
+
+		Task::TaskID spawn_packed(const KernelRegistry::KernelID& 	kernel, 
+								  unsigned 							min, 
+								  unsigned 							max, 
+								  const std::string& 				args, 
+								  const Task::TaskIDList& 			deps,
+								  const Task::InputList& 			inputs,
+								  const Task::FileList& 			files) 
+		{
+			return get_role().spawn(kernel, min, max, deps, args, inputs, files);
+		}
+
+	} // end namespace detail
+
+	Task::TaskID spawn(const std::string& kernel, const Task::TaskIDList& deps) {
+
+		auto& r = get_role();
+
+		auto id = r.kernels().id(kernel);
+		assert(id != KernelRegistry::INVALID && "Kernel not registered");
+
+		const KernelDesc& desc = r.kernels()[id];
+		return r.spawn(id, desc.min, desc.max, deps, std::string(), Task::InputList(), Task::FileList());
+
+	}
+
+	TaskRange spawn_n(const std::string& kernel, unsigned count, unsigned min, unsigned max) {
+
+		auto& r = get_role();
+		return r.spawn_n(kernel_id(r, kernel), count, min, max);
+
+	}
+
+	std::string wait_for(const Task::TaskID& tid) {
+
+		auto& r = get_role();  
+		r.wait_all( Task::TaskIDList({tid}) );
+
+		return r.result(tid);
+	}
+
+	void set_result(const std::string& result) {
 
 		auto& r = get_role();
-		return r.spawn(kernel, min, max);
+		r.set_result(result);
+
+	}
+
+	void wait_all(const Task::TaskIDList& tids) {
+
+		auto& r = get_role();  
+		r.wait_all(tids);
 
 	}
 
-	void wait_for(const Task::TaskID& tid) {
+	Task::TaskID wait_any(const Task::TaskIDList& tids) {
 
 		auto& r = get_role();  
-		r.wait_for(tid);
+		return r.wait_any(tids);
+
+	}
+
+
+	ObjectRef put(const void* data, size_t size) {
 
+		if (size == 0) { return ObjectRef{0, 0}; }
+
+		auto& r = get_role();
+
+		ObjectRef ref = { ObjectStore::next_id(r.node()), size };
+		if (!utils::shm_create(ObjectStore::name(ref.id), data, size)) {
+			LOG(ERROR) << "Cannot store an object of " << size << " bytes";
+			return ObjectRef{0, 0};
+		}
+
+		r.store_insert(ref);
+		return ref;
+	}
+
+	ObjectView get(const ObjectRef& ref) {
+
+		if (ref.id == 0) { return ObjectView(); }
+
+		// the scheduler learns about the mapping before it is established, therefore the 
+		// object is either already gone or kept until the view goes away 
+		auto& r = get_role();
+		r.store_acquire(ref.id);
+
+		return ObjectView(ref, [&r](const ObjectID& id) { r.store_release(id); });
 	}
 
+	StreamRef make_stream(size_t capacity) {
+
+		auto& r = get_role();
+
+		StreamRef ref = Stream::create(capacity, r.node());
+		if (ref.id) { r.stream_insert(ref.id); }
+		return ref;
+
+	}
 
 	Task::TaskID get_tid() {
 			
@@ -1,5 +1,8 @@
 
 #include "worker.h"
+#include "kernel.h"
+#include "payload.h"
+#include "stack_pool.h"
 
 #include "comm/message.h"
 #include "comm/channel.h"
@@ -7,24 +10,107 @@
 #include "utils/logging.h"
 #include "utils/string.h"
 
-#include <dlfcn.h>
+#include <sched.h>
+#include <sys/resource.h>
 
+#include <chrono>
+#include <deque>
+#include <numeric>
 #include <thread>
+#include <unordered_map>
+#include <unordered_set>
 
 #include <boost/context/all.hpp>
 
 namespace ctx = boost::context;
 
+#define TID_LEASE_SIZE 64u
+
+// Stack size of the tasks (in KiB) when MPITS_STACK_SIZE is not set
+#define DEFAULT_STACK_SIZE 1024u
+
+// Bytes below the stack pointer of a suspended task which are never reclaimed 
+#define STACK_TRIM_MARGIN 4096
+
+// Time (usecs) an idle worker polls for the next request before going to sleep 
+#define LAUNCH_POLL_USECS 200u
+
 
 namespace mpits {
 
+	// context of the worker loop, tasks jump back here when they suspend or complete 
+	ctx::fcontext_t fcw;
+	ctx::fcontext_t* curr_ptr=nullptr;
+
+	size_t default_stack_size() {
+		const char* size = getenv("MPITS_STACK_SIZE");
+		return (size ? strtoul(size, nullptr, 10) : DEFAULT_STACK_SIZE) * 1024;
+	}
+
+	// stacks of the coroutines, recycled across tasks 
+	StackPool stack_pool( default_stack_size() );
+
+	/**
+	 * Deepest stack usage observed for a kernel, when MPITS_ADAPTIVE_STACKS is set the 
+	 * next launches of the kernel get a stack twice as large instead of the default one 
+	 */
+	struct StackProfile {
+		size_t 		high_water;
+		unsigned 	runs;
+
+		StackProfile() : high_water(0), runs(0) { }
+	};
+
+	std::unordered_map<KernelRegistry::KernelID, StackProfile> stack_profiles;
+
+	bool adaptive_stacks = getenv("MPITS_ADAPTIVE_STACKS") != nullptr;
+
+	size_t stack_size(const StackProfile& profile) {
+		if (!adaptive_stacks || profile.runs == 0) { return stack_pool.default_size(); }
+		return StackPool::size_class(2*profile.high_water);
+	}
+
+	// child task queued for inline execution 
+	struct InlineTask {
+		Task::TaskID 				tid;
+		KernelRegistry::KernelID 	kernel;
+		std::string 				args;
+	};
+
 	struct TaskDesc {
 
 		Task::TaskID					m_tid;
 		MPI_Comm 						m_comm; 
 		ctx::fcontext_t* 				m_ctx_ptr;
 		void*							m_stack_ptr;
-		ctx::guarded_stack_allocator& 	m_alloc;
+		size_t 							m_stack_size;
+		StackPool& 						m_alloc;
+
+		// context the task returns to once completed 
+		ctx::fcontext_t* 				m_ret_ptr;
+
+		// arguments of the task (encoded), their view and the context passed to the kernel 
+		std::string 					m_args;
+		Payload 						m_args_view;
+		TaskContext 					m_context;
+
+		// result set by the kernel and results of other tasks handed to this one 
+		std::string 										m_result;
+		std::unordered_map<Task::TaskID, std::string> 		m_results;
+
+		std::deque<InlineTask> 				m_inline_tasks;
+		std::unordered_set<Task::TaskID> 	m_inline_tids;
+
+		// stack usage of the kernel, updated when the task completes 
+		StackProfile* 						m_profile;
+
+		// lowest address of the stack in use while the task is suspended 
+		char* 								m_suspend_sp;
+		std::chrono::high_resolution_clock::time_point m_suspend_time;
+		bool 								m_trimmed;
+
+		// the task is part of a bundle, its completion is reported with the whole bundle 
+		bool 								m_bundled;
 
 		TaskDesc(const TaskDesc&) = delete;
 		TaskDesc& operator=(const TaskDesc&) = delete;
@@ -33,22 +119,127 @@ namespace mpits {
 				 const MPI_Comm& 				comm, 
 				 ctx::fcontext_t* 				ctx_ptr, 
 				 void*							stack_ptr,
-				 ctx::guarded_stack_allocator&  alloc) : 
+				 size_t 						stack_size,
+				 StackPool&  					alloc,
+				 ctx::fcontext_t* 				ret_ptr = &fcw) : 
 			m_tid(tid), 
 			m_comm(comm), 
 			m_ctx_ptr(ctx_ptr), 
 			m_stack_ptr(stack_ptr), 
-			m_alloc(alloc) { }
+			m_stack_size(stack_size),
+			m_alloc(alloc),
+			m_ret_ptr(ret_ptr),
+			m_context{comm, nullptr, 0},
+			m_profile(nullptr),
+			m_suspend_sp(nullptr), 
+			m_trimmed(false),
+			m_bundled(false) { }
 
 		const MPI_Comm& comm() const { return m_comm; }
 
+		/**
+		 * Sets the encoded arguments of the task, arguments in shared memory are mapped in 
+		 * place. Returns false if they could not be mapped. 
+		 */
+		bool set_args(std::string&& args) { 
+			m_args = std::move(args); 
+			m_args_view = Payload(m_args);
+			m_context.args = m_args_view.data();
+			m_context.args_size = m_args_view.size();
+			return m_args_view.valid();
+		}
+
+		const std::string& args() const { return m_args; }
+
+		std::string& result() { return m_result; }
+
+		// Keeps the (encoded) result of the task tid until the kernel asks for it 
+		void deliver_result(const Task::TaskID& tid, std::string&& result) {
+			m_results[tid] = std::move(result);
+		}
+
+		// Returns the result of tid delivered to this task, false if there is none 
+		bool take_result(const Task::TaskID& tid, std::string& result) {
+			auto fit = m_results.find(tid);
+			if (fit == m_results.end()) { return false; }
+
+			result = std::move(fit->second);
+			m_results.erase(fit);
+			return true;
+		}
+
+		const TaskContext& context() const { return m_context; }
+
 		const Task::TaskID& tid() const { return m_tid; }
 
 		ctx::fcontext_t* ctx() const { return m_ctx_ptr; }
 
+		ctx::fcontext_t* ret() const { return m_ret_ptr; }
+
+		// A task executed inline returns to its parent and is unknown to the scheduler 
+		bool is_inline() const { return m_ret_ptr != &fcw; }
+
+		void set_bundled() { m_bundled = true; }
+
+		bool is_bundled() const { return m_bundled; }
+
+		void push_inline(const Task::TaskID& tid, const KernelRegistry::KernelID& kernel, const std::string& args) {
+			m_inline_tasks.push_back( InlineTask{tid, kernel, args} );
+			m_inline_tids.insert(tid);
+		}
+
+		std::deque<InlineTask>& inline_tasks() { return m_inline_tasks; }
+
+		bool is_inline_child(const Task::TaskID& tid) const { return m_inline_tids.count(tid) > 0; }
+
+		bool is_queued(const Task::TaskID& tid) const {
+			return std::find_if(m_inline_tasks.begin(), m_inline_tasks.end(), 
+					[&](const InlineTask& cur) { return cur.tid == tid; }) != m_inline_tasks.end();
+		}
+
+		void suspended(char* sp) {
+			m_suspend_sp = sp;
+			m_suspend_time = std::chrono::high_resolution_clock::now();
+			m_trimmed = false;
+		}
+
+		void resumed() { m_suspend_sp = nullptr; }
+
+		void set_profile(StackProfile& profile) { m_profile = &profile; }
+
+		/**
+		 * Releases the pages of the stack below the frames of a task suspended for longer 
+		 * than threshold, returns the number of bytes released 
+		 */
+		size_t trim_stack(const std::chrono::milliseconds& threshold) {
+			if (!m_suspend_sp || m_trimmed || 
+				std::chrono::high_resolution_clock::now() - m_suspend_time < threshold) 
+			{ 
+				return 0; 
+			}
+
+			// the usage of a trimmed stack cannot be measured anymore 
+			m_trimmed = true;
+			m_profile = nullptr;
+			return StackPool::trim(m_stack_ptr, m_stack_size, m_suspend_sp - STACK_TRIM_MARGIN);
+		}
+
 		~TaskDesc() {
-			MPI_Comm_free(&m_comm);
-			m_alloc.deallocate(m_stack_ptr, ctx::guarded_stack_allocator::maximum_stacksize());
+			if (m_profile) {
+				size_t used = StackPool::used(m_stack_ptr, m_stack_size);
+				if (used == m_stack_size) {
+					LOG(WARNING) << "Task " << m_tid << " used its whole stack of " << m_stack_size << " bytes";
+				}
+
+				m_profile->high_water = std::max(m_profile->high_water, used);
+				++m_profile->runs;
+			}
+
+			// results which were never asked for 
+			for (const auto& cur : m_results) { Payload::release(cur.second); }
+
+			if (m_comm != MPI_COMM_SELF) { MPI_Comm_free(&m_comm); }
+			m_alloc.deallocate(m_stack_ptr, m_stack_size);
 		}
 	
 	};
@@ -69,6 +260,9 @@ namespace {
 	using namespace mpits; 
 
 	/**
+	 * Builds the communicator of a group given the ranks (in MPI_COMM_WORLD) of its 
+	 * members, the group may span multiple nodes. 
+	 *
 	 * taken the idea from:
 	 *  	https://svn.mcs.anl.gov/repos/mpi/mpich2/trunk/test/mpi/spawn/pgroup_intercomm_test.c
 	 */
@@ -78,10 +272,10 @@ namespace {
 		assert (!ranks.empty() );
 
 		/* CASE: Group size 1 */
-		if (ranks.size() == 1 && ranks.front() == worker.node_rank()) { return MPI_COMM_SELF; }
+		if (ranks.size() == 1 && ranks.front() == worker.world_rank()) { return MPI_COMM_SELF; }
 
 
-		auto fit = std::find(ranks.begin(), ranks.end(), worker.node_rank());
+		auto fit = std::find(ranks.begin(), ranks.end(), worker.world_rank());
 		assert(fit != ranks.end());
 
 		size_t idx = std::distance(ranks.begin(), fit);
@@ -116,14 +310,105 @@ namespace {
 
 	void call_back(int sig) { }
 
+	/**
+	 * Polls for a request of the scheduler for up to LAUNCH_POLL_USECS, returns false if 
+	 * none arrived. Requests for ranks which are about to finish a task are sent without 
+	 * waking them up. 
+	 */
+	bool poll_request(const MPI_Comm& comm, MPI_Status& status) {
+
+		auto deadline = std::chrono::high_resolution_clock::now() + std::chrono::microseconds(LAUNCH_POLL_USECS);
+		do {
+			int flag = 0;
+			MPI_Iprobe(0, MPI_ANY_TAG, comm, &flag, &status);
+			if (flag) { return true; }
+
+			sched_yield();
+		} while (std::chrono::high_resolution_clock::now() < deadline);
+
+		return false;
+	}
+
+	/**
+	 * Arguments in shared memory are mapped in place by every rank of the group, if some 
+	 * rank could not map them (the group spans multiple nodes) the leader broadcasts their 
+	 * content instead 
+	 */
+	void share_args(TaskDesc& desc, bool mapped) {
+
+		int all, local = mapped;
+		MPI_Allreduce(&local, &all, 1, MPI_INT, MPI_MIN, desc.comm());
+		if (all) { return; }
+
+		std::string data(desc.context().args_size, '\0');
+
+		int rank;
+		MPI_Comm_rank(desc.comm(), &rank);
+		if (rank==0) { data.assign(desc.context().args, desc.context().args_size); }
+
+		MPI_Bcast(&data[0], data.size(), MPI_BYTE, 0, desc.comm());
+
+		// the leader keeps its mapping, the object is released when the task completes 
+		if (!mapped) { desc.set_args( Payload::encode(data, data.size()) ); }
+	}
+
+	/**
+	 * Executes the most recently queued inline child of the current task on a new 
+	 * coroutine, the child jumps back here when it finalizes and its tid is appended to 
+	 * done. Returns false if the current task has no queued children.
+	 */
+	bool run_next_inline(const KernelRegistry& kernels, Task::TaskIDList& done) {
+
+		assert(curr_active_task != active_tasks.end() && "curr task pointer is not valid!");
+
+		TaskDesc& parent = *curr_active_task->second;
+		if (parent.inline_tasks().empty()) { return false; }
+
+		InlineTask child = std::move(parent.inline_tasks().back());
+		parent.inline_tasks().pop_back();
+
+		StackProfile& profile = stack_profiles[child.kernel];
+
+		std::size_t size = stack_size(profile);
+		auto* stack = stack_pool.allocate(size);
+		auto* fc = ctx::make_fcontext( stack, size, kernels[child.kernel].entry );
+
+		Task::TaskID parent_tid = parent.tid();
+		ctx::fcontext_t* parent_ptr = curr_ptr;
+
+		curr_active_task = active_tasks.insert( 
+			std::make_pair(
+				child.tid, 
+				TaskDescPtr( new TaskDesc(child.tid, MPI_COMM_SELF, fc, stack, size, stack_pool, parent_ptr) )
+			)).first;
+		curr_active_task->second->set_profile(profile);
+		curr_active_task->second->set_args( Payload::encode(child.args, child.args.size()) );
+
+		curr_ptr = fc;
+		ctx::jump_fcontext( parent_ptr, fc, (intptr_t)&curr_active_task->second->context() );
+
+		// back from the finalize of the child 
+		curr_active_task = active_tasks.find(parent_tid);
+		curr_ptr = parent_ptr;
+
+		done.push_back(child.tid);
+
+		// the result of the child stays with the parent 
+		std::string& result = ctx_clean.back()->result();
+		if (!result.empty()) {
+			curr_active_task->second->deliver_result(child.tid, Payload::encode(result, result.size()));
+		}
+
+		// the stack of the child is not in use anymore 
+		ctx_clean.clear();
+		return true;
+	}
+
 } // end anonymous namespace 
 
 
 namespace mpits {
 
-	ctx::fcontext_t fcw;
-	ctx::fcontext_t* curr_ptr=nullptr;
-
 	Task::TaskID Worker::get_tid() {
 		assert(curr_active_task != active_tasks.end() && "curr task pointer is not valid!");
 
@@ -132,45 +417,239 @@ namespace mpits {
 		return desc.tid();
 	}
 
-	// Send the request to the Scheduler, wait for the TaskID and return 
-	Task::TaskID Worker::spawn(const std::string& kernel, unsigned min, unsigned max) {
+	void Worker::request_lease() {
+
+		assert(m_lease_req == MPI_REQUEST_NULL);
+
+		// the receive is posted before the request, so the reply (tag 4) is never 
+		// matched by the probe of the main loop 
+		MPI_Irecv(&m_lease_first, 1, MPI_UNSIGNED_LONG, 0, 4, node_comm(), &m_lease_req);
+
+		comm::SendChannel()( 
+			comm::Message(comm::Message::TID_LEASE, 0, node_comm(), std::make_tuple(TID_LEASE_SIZE)) 
+		);
+	}
+
+	Task::TaskID Worker::next_tid() {
+
+		if (m_lease.left == 0) {
+			if (m_lease_req == MPI_REQUEST_NULL) { request_lease(); }
+
+			MPI_Wait(&m_lease_req, MPI_STATUS_IGNORE);
+			m_lease.next = m_lease_first;
+			m_lease.left = TID_LEASE_SIZE;
+		}
+
+		Task::TaskID tid = m_lease.next++;
+		--m_lease.left;
+
+		if (m_lease.left == TID_LEASE_SIZE/2 && m_lease_req == MPI_REQUEST_NULL) { request_lease(); }
+
+		return tid;
+	}
+
+	void Worker::reclaim_stacks() {
+
+		size_t released = 0;
+		for (auto& cur : active_tasks) { 
+			released += cur.second->trim_stack(std::chrono::milliseconds(m_reclaim_after));
+		}
+
+		if (released) { 
+			LOG(DEBUG) << "Released " << released/1024 << " KiB of stack of suspended tasks"; 
+		}
+	}
+
+	void Worker::report_inlined() {
 
+		if (m_inlined.empty()) { return; }
+
+		comm::SendChannel()( 
+			comm::Message(comm::Message::TASK_INLINE, 0, node_comm(), std::make_tuple(m_inlined)) 
+		);
+		m_inlined.clear();
+	}
+
+	// Takes the TaskID from the leased block and sends the request to the Scheduler 
+	// without waiting for a reply
+	Task::TaskID Worker::spawn(const KernelRegistry::KernelID& 	kernel, 
+							   unsigned 				min, 
+							   unsigned 				max, 
+							   const Task::TaskIDList& 	deps,
+							   const std::string& 		args,
+							   const Task::InputList& 	inputs,
+							   const Task::FileList& 	files) 
+	{
 		using namespace comm;
 
-		auto task_data = std::make_tuple(kernel, min, max);
+		Task::TaskID tid = next_tid();
+
+		bool local = std::all_of(inputs.begin(), inputs.end(), 
+				[&](const ObjectRef& cur) { return ObjectStore::node_of(cur.id) == static_cast<unsigned>(node()); });
+
+		// Single-rank children reading objects of this node are queued locally and run by this 
+		// worker, tasks reading files go through the scheduler which stages them. Only tasks 
+		// running on a single rank inline children: the other ranks of a group would not know 
+		// the child and their collectives would no longer match. 
+		int group_size = 0;
+		if (curr_active_task != active_tasks.end()) { MPI_Comm_size(curr_active_task->second->comm(), &group_size); }
+
+		if (m_inline && min == 1 && max == 1 && deps.empty() && local && files.empty() && 
+			kernel < kernels().size() && group_size == 1) 
+		{
+			curr_active_task->second->push_inline(tid, kernel, args);
+			return tid;
+		}
+
+		// large arguments go through shared memory, the scheduler only sees their name 
+		auto task_data = std::make_tuple(tid, kernel, min, max, deps, Payload::encode(args), inputs, files);
 		SendChannel()( Message(Message::TASK_CREATE, 0, node_comm(), task_data) );
 		
-		Task::TaskID tid;
-		MPI_Recv(&tid, 1, MPI_UNSIGNED_LONG, 0, 0, node_comm(), MPI_STATUS_IGNORE);
-		
 		LOG(DEBUG) << "Task generated: " << tid;
 
 		return tid;
 	}
 
+	// Send one request for the whole batch, the scheduler replies with the first TaskID 
+	TaskRange Worker::spawn_n(const KernelRegistry::KernelID& kernel, unsigned count, unsigned min, unsigned max) {
+
+		using namespace comm;
+
+		if (count == 0) { return TaskRange{0, 0}; }
+
+		auto task_data = std::make_tuple(kernel, count, min, max);
+		SendChannel()( Message(Message::TASK_CREATE_N, 0, node_comm(), task_data) );
+		
+		TaskRange range = { 0, count };
+		MPI_Recv(&range.first, 1, MPI_UNSIGNED_LONG, 0, 0, node_comm(), MPI_STATUS_IGNORE);
+		
+		LOG(DEBUG) << "Tasks generated: " << range.first << "..." << range[count-1];
+
+		return range;
+	}
+
+	void Worker::set_result(const std::string& result) {
+
+		assert(curr_active_task != active_tasks.end() && "curr task pointer is not valid!");
+		curr_active_task->second->result() = result;
+
+	}
+
+	std::string Worker::fetch_result(const Task::TaskID& tid) {
+
+		comm::SendChannel()( 
+			comm::Message(comm::Message::TASK_RESULT, 0, node_comm(), std::make_tuple(tid)) 
+		);
+
+		MPI_Status status;
+		MPI_Probe(0, 5, node_comm(), &status);
+
+		int size;
+		MPI_Get_count(&status, MPI_BYTE, &size);
+
+		std::string result(size, '\0');
+		MPI_Recv(&result[0], size, MPI_BYTE, 0, 5, node_comm(), MPI_STATUS_IGNORE);
+		return result;
+	}
+
+	std::string Worker::result(const Task::TaskID& tid) {
+
+		assert(curr_active_task != active_tasks.end() && "curr task pointer is not valid!");
+
+		TaskDesc& desc = *curr_active_task->second;
+
+		int rank;
+		MPI_Comm_rank(desc.comm(), &rank);
+
+		/**
+		 * The leader takes the result handed over with the wakeup (or left by an inline 
+		 * child), otherwise it asks the scheduler, and forwards it to the group 
+		 */
+		std::string data;
+		if (rank==0) {
+			std::string encoded;
+			if (!desc.take_result(tid, encoded) && tid != desc.tid() && !desc.is_inline_child(tid)) {
+				encoded = fetch_result(tid);
+			}
+
+			data = Payload(encoded).str();
+			Payload::release(encoded);
+		}
+
+		unsigned long size = data.size();
+		MPI_Bcast(&size, 1, MPI_UNSIGNED_LONG, 0, desc.comm());
+
+		if (size) {
+			data.resize(size);
+			MPI_Bcast(&data[0], size, MPI_BYTE, 0, desc.comm());
+		}
+		return data;
+	}
+
+	void Worker::store_insert(const ObjectRef& ref) {
+		comm::SendChannel()( 
+			comm::Message(comm::Message::OBJECT_PUT, 0, node_comm(), std::make_tuple(ref.id, ref.size)) 
+		);
+	}
+
+	void Worker::store_acquire(const ObjectID& id) {
+		comm::SendChannel()( 
+			comm::Message(comm::Message::OBJECT_ACQUIRE, 0, node_comm(), std::make_tuple(id)) 
+		);
+	}
+
+	void Worker::store_release(const ObjectID& id) {
+		comm::SendChannel()( 
+			comm::Message(comm::Message::OBJECT_RELEASE, 0, node_comm(), std::make_tuple(id)) 
+		);
+	}
+
+	void Worker::stream_insert(const ObjectID& id) {
+		comm::SendChannel()( 
+			comm::Message(comm::Message::STREAM_CREATE, 0, node_comm(), std::make_tuple(id)) 
+		);
+	}
+
 	void Worker::finalize() {
 
 		assert(curr_active_task != active_tasks.end() && "curr task pointer is not valid!");
 
 		TaskDesc& desc = *curr_active_task->second;
 
-		// Makes sure that all the workers have reached the end of the kernel 
-		MPI_Barrier(desc.comm());
+		// Children still queued inline are executed before the task completes 
+		while (run_next_inline(kernels(), m_inlined)) ;
 
 		int rank;
 		MPI_Comm_rank(desc.comm(), &rank);
 
+		// The next task can be assigned to the ranks while the group waits for the others 
+		if (m_pipelined && rank==0 && !desc.is_inline() && !desc.is_bundled()) {
+			comm::SendChannel()( 
+				comm::Message(comm::Message::TASK_FINISHING, 0, node_comm(), std::make_tuple(desc.tid())) 
+			);
+		}
+
+		// Makes sure that all the workers have reached the end of the kernel 
+		MPI_Barrier(desc.comm());
+
+		if (!desc.is_inline()) { report_inlined(); }
+
 		// kernel completition
-		if (rank==0) {
-			// Send the completition message to the scheduler 
+		if (rank==0 && !desc.is_inline() && !desc.is_bundled()) {
+			// Send the completition message, with the result of the task, to the scheduler 
 			comm::SendChannel()( 
-				comm::Message(comm::Message::TASK_COMPLETED, 0, node_comm(), std::make_tuple(desc.tid())) 
+				comm::Message(comm::Message::TASK_COMPLETED, 0, node_comm(), 
+							  std::make_tuple(desc.tid(), Payload::encode(desc.result()))) 
 			);
 		}
 
+		// every rank of the group is done with the arguments 
+		if (rank==0) { Payload::release(desc.args()); }
+
 		assert(curr_ptr && "Curr context pointer is invalid, how did you manage to jump here?");
 		auto* ptr = curr_ptr;
-		curr_ptr = &fcw;
+		auto* ret = desc.ret();
+		curr_ptr = ret;
 		
 		// erase task from the map 
 		ctx_clean.emplace_back( std::move(curr_active_task->second) );
@@ -178,7 +657,7 @@ namespace mpits {
 		active_tasks.erase(curr_active_task);
 		curr_active_task = active_tasks.end();
 
-		ctx::jump_fcontext(ptr, &fcw, 0);
+		ctx::jump_fcontext(ptr, ret, 0);
 	}
 
 	void Worker::do_work() {
@@ -186,28 +665,23 @@ namespace mpits {
 		signal(SIGCONT, call_back);
 		LOG(INFO) << "Starting worker";
 		
-		// Initialize the context 
-		ctx::guarded_stack_allocator alloc;
-        std::size_t size = ctx::guarded_stack_allocator::maximum_stacksize();
-        
 		bool stop=false;
 
-		LOG(DEBUG) << "Opening kernel.so...";
-		void* handle = dlopen("./libkernels.so", RTLD_NOW);
-		if (!handle) {
-			LOG(ERROR) << "Cannot open library: " << dlerror();
-			::exit(1);
-		}
-
 		MPI_Barrier(MPI_COMM_WORLD);
 
+		// the first block of tids is leased before any task runs 
+		request_lease();
+
 		while (!stop) {
-			LOG(DEBUG) << "Sleep";
 
-			pause();
-			
+			// the next task may be on its way already 
 			MPI_Status status;
-			MPI_Probe(0, MPI_ANY_TAG, node_comm(), &status);
+			if (!m_pipelined || !poll_request(node_comm(), status)) {
+				LOG(DEBUG) << "Sleep";
+
+				pause();
+				MPI_Probe(0, MPI_ANY_TAG, node_comm(), &status);
+			}
 
 			switch (status.MPI_TAG) {
 
@@ -223,7 +697,7 @@ namespace mpits {
 
 				int size;
 				// we expect to receive a list of integers representing 
-				// the process ranks which will form the group 
+				// the process ranks (in MPI_COMM_WORLD) which will form the group 
 				MPI_Get_count(&status, MPI_INT, &size);
 
 				std::vector<int> ranks(size);
@@ -236,90 +710,147 @@ namespace mpits {
 				MPI_Comm comm = make_group(*this,ranks);
 				MPI_Barrier(comm);
 
-				char* kernel_name = nullptr;
-
 				int new_rank;
 				MPI_Comm_rank(comm, &new_rank);
 
-				unsigned long tid;
+				// tid of the task, id of the kernel and size of the packed arguments, the 
+				// leader receives them (and the arguments) from the scheduler and forwards 
+				// them to the rest of the group 
+				unsigned long desc[3];
+				std::string args;
 
 				if (new_rank==0) {
 					LOG(DEBUG) << "GROUP FORMED!";
-
-					// retrieve tid
-					MPI_Recv(&tid, 1, MPI_UNSIGNED_LONG, 0, 0, node_comm(), MPI_STATUS_IGNORE);
-
-					MPI_Bcast(&tid, 1, MPI_UNSIGNED_LONG, 0, comm);
-					// retrieve work 
-					MPI_Status status;
-					MPI_Probe(0, MPI_ANY_TAG, node_comm(), &status); 
-
-					assert(status.MPI_TAG == 0);
-					MPI_Get_count(&status, MPI_CHAR, &size);
-					kernel_name = new char[size];
-
-					MPI_Recv(kernel_name, size, MPI_CHAR, 0, 0, node_comm(), MPI_STATUS_IGNORE);
-
-					MPI_Bcast(&size, 1, MPI_INT, 0, comm);
-					MPI_Bcast(kernel_name, size, MPI_CHAR, 0, comm);
-				} else {
-					// remaining processes in the group retirive:guarded_stack_allocator
-					//  -> tid
-					MPI_Bcast(&tid, 1, MPI_UNSIGNED_LONG, 0, comm);
-					//	-> kernel_name_size
-					MPI_Bcast(&size, 1, MPI_INT, 0, comm);
-					kernel_name = new char[size];
-					//	-> kernel_name 
-					MPI_Bcast(kernel_name, size, MPI_CHAR, 0, comm);
+					MPI_Recv(desc, 3, MPI_UNSIGNED_LONG, 0, 0, node_comm(), MPI_STATUS_IGNORE);
+				}
+				MPI_Bcast(desc, 3, MPI_UNSIGNED_LONG, 0, comm);
+
+				if (desc[2]) {
+					args.resize(desc[2]);
+					if (new_rank==0) {
+						MPI_Recv(&args[0], desc[2], MPI_BYTE, 0, 0, node_comm(), MPI_STATUS_IGNORE);
+					}
+					MPI_Bcast(&args[0], desc[2], MPI_BYTE, 0, comm);
 				}
 
-				LOG(DEBUG) << "TID: " << tid << " - recvd kernel '" << kernel_name << "'";
-
-				typedef void (*kernel_t)(intptr_t);
+				Task::TaskID tid = desc[0];
+				auto kernel = static_cast<KernelRegistry::KernelID>(desc[1]);
+				assert(kernel < kernels().size() && "Kernel not registered");
 
-				// reset errors
-				dlerror();
-				kernel_t kernel = (kernel_t) dlsym(handle, kernel_name);
+				LOG(DEBUG) << "TID: " << tid << " - calling '" << kernels()[kernel].name << "'...";
 
-				const char *dlsym_error = dlerror();
-				if (dlsym_error) {
-					LOG(ERROR) << "Cannot load symbol '" << kernel_name << "': " << dlsym_error;
-					dlclose(handle);
-				}
-		
-				// use it to do the calculation
-				LOG(DEBUG) << "Calling '" << kernel_name << "'...";
-				delete[] kernel_name;
+				StackProfile& profile = stack_profiles[kernel];
 			
-				auto* stack = alloc.allocate(size);
-				auto* fc = ctx::make_fcontext( stack, size, kernel );
+				std::size_t stack_size = mpits::stack_size(profile);
+				auto* stack = stack_pool.allocate(stack_size);
+				auto* fc = ctx::make_fcontext( stack, stack_size, kernels()[kernel].entry );
 				
 				curr_active_task = active_tasks.insert( 
 					std::make_pair(
 						tid,  
-						std::unique_ptr<TaskDesc>( new TaskDesc(tid, comm, fc, stack, alloc) )
+						std::unique_ptr<TaskDesc>( new TaskDesc(tid, comm, fc, stack, stack_size, stack_pool) )
 					)).first;
+				curr_active_task->second->set_profile(profile);
+
+				bool shared = Payload::is_shared(args);
+				bool mapped = curr_active_task->second->set_args( std::move(args) );
+				if (shared) { share_args(*curr_active_task->second, mapped); }
 
 				curr_ptr = fc;
-				ctx::jump_fcontext( &fcw, curr_ptr, (intptr_t)&comm);
+				ctx::jump_fcontext( &fcw, curr_ptr, (intptr_t)&curr_active_task->second->context() );
+				break;
+			}
+
+			case 2: // Run a bundle of tasks 
+			{
+				int size;
+				// id of the kernel followed by the tids of the tasks and the sizes of their 
+				// packed arguments, the arguments of all the tasks follow 
+				MPI_Get_count(&status, MPI_UNSIGNED_LONG, &size);
+
+				std::vector<unsigned long> desc(size);
+				MPI_Recv(&desc.front(), size, MPI_UNSIGNED_LONG, 0, 2, node_comm(), MPI_STATUS_IGNORE);
+
+				auto kernel = static_cast<KernelRegistry::KernelID>(desc[0]);
+				assert(kernel < kernels().size() && "Kernel not registered");
+
+				size_t count = (desc.size()-1)/2;
+				Task::TaskIDList tids(desc.begin()+1, desc.begin()+1+count);
+
+				std::string args( std::accumulate(desc.begin()+1+count, desc.end(), 0ul), '\0' );
+				if (!args.empty()) {
+					MPI_Recv(&args[0], args.size(), MPI_BYTE, 0, 2, node_comm(), MPI_STATUS_IGNORE);
+				}
+
+				LOG(DEBUG) << "Running bundle of " << count << " task(s) calling '" << kernels()[kernel].name << "'";
+
+				StackProfile& profile = stack_profiles[kernel];
+
+				std::vector<std::string> results;
+				std::vector<double> runtimes;
+				size_t offset = 0;
+
+				for (size_t idx=0; idx<count; ++idx) {
+					auto start = std::chrono::high_resolution_clock::now();
+
+					std::size_t stack_size = mpits::stack_size(profile);
+					auto* stack = stack_pool.allocate(stack_size);
+					auto* fc = ctx::make_fcontext( stack, stack_size, kernels()[kernel].entry );
+
+					curr_active_task = active_tasks.insert( 
+						std::make_pair(
+							tids[idx],  
+							std::unique_ptr<TaskDesc>( new TaskDesc(tids[idx], MPI_COMM_SELF, fc, stack, stack_size, stack_pool) )
+						)).first;
+					curr_active_task->second->set_profile(profile);
+					curr_active_task->second->set_bundled();
+					curr_active_task->second->set_args( args.substr(offset, desc[1+count+idx]) );
+					offset += desc[1+count+idx];
+
+					curr_ptr = fc;
+					ctx::jump_fcontext( &fcw, curr_ptr, (intptr_t)&curr_active_task->second->context() );
+
+					// back from the finalize of the task, its stack is reused by the next one 
+					assert(!ctx_clean.empty());
+					results.push_back( Payload::encode(ctx_clean.back()->result()) );
+					ctx_clean.clear();
+
+					std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+					runtimes.push_back(elapsed.count());
+				}
+
+				comm::SendChannel()( 
+					comm::Message(comm::Message::TASK_BUNDLE_COMPLETED, 0, node_comm(), 
+								  std::make_tuple(tids, results, runtimes)) 
+				);
 				break;
 			}
 
 			case 3:	// Resume Worker 
 			{
 				LOG(INFO) << "RESUME";
-				Task::TaskID tid;
-				MPI_Recv(&tid, 1, MPI_UNSIGNED_LONG, 0, 3, node_comm(), MPI_STATUS_IGNORE);
+				// tid of the task to resume, of the task whose completion woke it up and the 
+				// size of its result, which the leader receives right after 
+				Task::TaskID desc[3];
+				MPI_Recv(desc, 3, MPI_UNSIGNED_LONG, 0, 3, node_comm(), MPI_STATUS_IGNORE);
+				Task::TaskID tid = desc[0];
 				
 				auto fit = active_tasks.find( tid );
 				assert(fit != active_tasks.end() && "Scheduler required to resume completed task");
 
+				if (desc[2]) {
+					std::string result(desc[2], '\0');
+					MPI_Recv(&result[0], desc[2], MPI_BYTE, 0, 3, node_comm(), MPI_STATUS_IGNORE);
+					fit->second->deliver_result(desc[1], std::move(result));
+				}
+
 				curr_ptr = fit->second->ctx();
 				
 				curr_active_task = active_tasks.find(tid);
 				assert(curr_active_task != active_tasks.end());
 
-				ctx::jump_fcontext( &fcw, curr_ptr, 0 );
+				curr_active_task->second->resumed();
+				ctx::jump_fcontext( &fcw, curr_ptr, static_cast<intptr_t>(desc[1]) );
 
 				break;
 			}
@@ -330,46 +861,104 @@ namespace mpits {
 
 			// Clears the completed contextes by invoking the constructors 
 			ctx_clean.clear();
+
+			if (m_reclaim_after >= 0) { reclaim_stacks(); }
+
+			// the stack of the next task is ready before the worker goes idle 
+			if (m_pipelined) { stack_pool.reserve(stack_pool.default_size()); }
 		}
 
 		LOG(INFO) << "\{W@} Worker Exiting!";
 
-		dlclose(handle);
+		struct rusage usage;
+		getrusage(RUSAGE_SELF, &usage);
+		LOG(INFO) << "Worker mapped " << stack_pool.mapped() << " stack(s) of " 
+				  << stack_pool.default_size()/1024 << " KiB, peak RSS " << usage.ru_maxrss << " KiB";
+
+		for (const auto& cur : stack_profiles) {
+			LOG(DEBUG) << "Kernel '" << kernels()[cur.first].name << "' used up to " << cur.second.high_water/1024 
+					   << " KiB of stack in " << cur.second.runs << " run(s)";
+		}
+
+		if (m_lease_req != MPI_REQUEST_NULL) {
+			MPI_Cancel(&m_lease_req);
+			MPI_Wait(&m_lease_req, MPI_STATUS_IGNORE);
+		}
+
 		MPI_Finalize();
 
 	}
 
-	void Worker::wait_for(const Task::TaskID& tid) {
+	Task::TaskID Worker::wait(const Task::TaskIDList& tids, bool any) {
 
 		assert(curr_active_task != active_tasks.end() && "curr task pointer is not valid!");
 
 		TaskDesc& desc = *curr_active_task->second;
 
 		/**
-		 * If the task id is the current one then we don't need to wait
+		 * If the task id is the current one then we don't need to wait, children queued 
+		 * inline are waited for by executing them 
 		 */
-		if (tid == desc.tid()) { return; }
+		Task::TaskIDList others, inlined;
+		for (auto tid : tids) { 
+			if (tid == desc.tid()) { 
+				if (any) { return tid; }
+			} else if (desc.is_inline_child(tid)) { 
+				if (any && !desc.is_queued(tid)) { return tid; }
+				inlined.push_back(tid);
+			} else { 
+				others.push_back(tid); 
+			}
+		}
+
+		while (!inlined.empty() && run_next_inline(kernels(), m_inlined)) {
+			if (any && std::find(inlined.begin(), inlined.end(), m_inlined.back()) != inlined.end()) { 
+				return m_inlined.back(); 
+			}
+		}
+		if (others.empty()) { return desc.tid(); }
+
+		// the rank is shared with the rest of the bundle, which cannot be suspended with it 
+		if (desc.is_bundled()) {
+			LOG(ERROR) << "Task " << desc.tid() << " runs a kernel flagged KernelDesc::BUNDLE, "
+					   << "it can only wait for its inline children";
+			::abort();
+		}
+
+		// the child runs on the frame of its parent, which cannot be suspended with it 
+		if (desc.is_inline()) {
+			LOG(ERROR) << "Task " << desc.tid() << " runs inline (MPITS_INLINE_TASKS), "
+					   << "it can only wait for its inline children";
+			::abort();
+		}
+
+		report_inlined();
 
 		int rank;
 		MPI_Comm_rank(desc.comm(), &rank);
 		MPI_Barrier(desc.comm());
 
 		if (rank==0) {
-			// Let the scheduler know that this task is now suspended waiting for tid 
+			// Let the scheduler know that this task is now suspended waiting for the tids 
 			comm::SendChannel()( 
 				comm::Message(
-					comm::Message::TASK_WAIT, 0, node_comm(), std::make_tuple(desc.tid(), tid)
+					comm::Message::TASK_WAIT, 0, node_comm(), std::make_tuple(desc.tid(), others, any)
 				) 
 			);
 		}
 
 		auto* ptr = curr_ptr;
 		curr_ptr = &fcw;
+
+		// frames below this one are not live while the task is suspended 
+		char marker;
+		desc.suspended(&marker);
 		
 		// erase task from the map 
 		curr_active_task = active_tasks.end();
 
-		ctx::jump_fcontext(ptr, &fcw, 0);
+		// the scheduler resumes the task passing the tid of the completed task 
+		return ctx::jump_fcontext(ptr, &fcw, 0);
 	}
 
 } // end namespace mpits 
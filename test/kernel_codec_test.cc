@@ -0,0 +1,41 @@
+
+#include <gtest/gtest.h>
+#include "kernel.h"
+
+using namespace mpits;
+
+namespace {
+
+	struct Point { double x, y; };
+
+	template <typename... Args>
+	std::tuple<Args...> round_trip(const std::tuple<Args...>& values) {
+		std::string buf = detail::pack_args(values);
+
+		std::tuple<Args...> ret;
+		detail::unpack_tuple(buf.data(), ret, typename detail::MakeIndices<sizeof...(Args)>::type());
+		return ret;
+	}
+
+} // end anonymous namespace
+
+TEST(KernelCodec, Scalars) {
+
+	auto values = std::make_tuple(42, 3.5, 'c', 7ul);
+	EXPECT_EQ(values, round_trip(values));
+
+	// trivially copyable values are copied as they are
+	EXPECT_EQ(sizeof(int)+sizeof(double), detail::pack_args(std::make_tuple(1, 2.0)).size());
+	EXPECT_TRUE(detail::pack_args(std::tuple<>()).empty());
+}
+
+TEST(KernelCodec, Containers) {
+
+	auto values = std::make_tuple(std::string("hello"), std::vector<int>({1, 2, 3}), std::vector<double>(), 5);
+	EXPECT_EQ(values, round_trip(values));
+
+	Point p = { 1.0, 2.0 };
+	auto points = round_trip(std::make_tuple(std::vector<Point>({p, p}), std::string()));
+	EXPECT_EQ(2u, std::get<0>(points).size());
+	EXPECT_EQ(2.0, std::get<0>(points)[1].y);
+}
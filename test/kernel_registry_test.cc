@@ -0,0 +1,55 @@
+
+#include <gtest/gtest.h>
+#include "kernel_registry.h"
+
+#include <cstdlib>
+
+using namespace mpits;
+
+TEST(KernelRegistry, Libraries) {
+
+	unsetenv("MPITS_KERNELS");
+	EXPECT_EQ(std::vector<std::string>({"./libkernels.so"}), KernelRegistry::libraries());
+
+	setenv("MPITS_KERNELS", "./liba.so::/opt/libb.so", 1);
+	EXPECT_EQ(std::vector<std::string>({"./liba.so", "/opt/libb.so"}), KernelRegistry::libraries());
+
+	unsetenv("MPITS_KERNELS");
+}
+
+TEST(KernelRegistry, Empty) {
+
+	KernelRegistry registry;
+	registry.load(std::vector<std::string>());
+
+	EXPECT_EQ(0u, registry.size());
+	EXPECT_EQ(KernelRegistry::INVALID, registry.id("kernel_1"));
+}
+
+TEST(KernelRegistry, Table) {
+
+	// the library built along with the tests, see kernels.cpp 
+	KernelRegistry registry;
+	registry.load(std::vector<std::string>({"./libkernels.so"}));
+
+	auto id = registry.id("busy_kernel");
+	ASSERT_NE(KernelRegistry::INVALID, id);
+	ASSERT_LT(id, registry.size());
+
+	const KernelDesc& desc = registry[id];
+	EXPECT_STREQ("busy_kernel", desc.name);
+	EXPECT_EQ(1u, desc.min);
+	EXPECT_EQ(1u, desc.max);
+	EXPECT_EQ(20000u, desc.cost);
+	EXPECT_EQ(0u, desc.flags);
+	EXPECT_NE(nullptr, desc.entry);
+
+	// typed kernels of the library are registered as well 
+	auto sum_id = registry.id("sum_kernel");
+	ASSERT_NE(KernelRegistry::INVALID, sum_id);
+	EXPECT_NE(id, sum_id);
+	EXPECT_STREQ("sum_kernel", registry[sum_id].name);
+
+	EXPECT_NE(KernelRegistry::INVALID, registry.id("kernel_1"));
+	EXPECT_EQ(KernelRegistry::INVALID, registry.id("missing_kernel"));
+}
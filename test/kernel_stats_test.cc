@@ -0,0 +1,43 @@
+
+#include <gtest/gtest.h>
+#include "kernel_stats.h"
+
+using namespace mpits;
+
+TEST(KernelStats, Runtime) {
+
+	KernelStats stats;
+	EXPECT_EQ(0u, stats.runs(0));
+	EXPECT_EQ(0.0, stats.runtime(0));
+
+	stats.record(0, 1.0);
+	EXPECT_DOUBLE_EQ(1.0, stats.runtime(0));
+
+	// the average moves towards the last runs 
+	stats.record(0, 2.0);
+	EXPECT_LT(1.0, stats.runtime(0));
+	EXPECT_GT(2.0, stats.runtime(0));
+	EXPECT_EQ(2u, stats.runs(0));
+	EXPECT_EQ(0u, stats.runs(1));
+}
+
+TEST(KernelStats, BundleSize) {
+
+	KernelStats stats;
+
+	// not enough runs observed yet 
+	stats.record(0, 1e-5);
+	EXPECT_EQ(1u, stats.bundle_size(0, 1e-3, 64));
+
+	for (unsigned i=0; i<10; ++i) { 
+		stats.record(0, 1e-5); 
+		stats.record(1, 4e-4);
+		stats.record(2, 1e-2);
+	}
+
+	EXPECT_EQ(64u, stats.bundle_size(0, 1e-3, 64));
+	EXPECT_EQ(10u, stats.bundle_size(0, 1e-3, 10));
+	EXPECT_EQ(2u, stats.bundle_size(1, 1e-3, 64));
+	EXPECT_EQ(1u, stats.bundle_size(2, 1e-3, 64));
+	EXPECT_EQ(1u, stats.bundle_size(3, 1e-3, 64));
+}
@@ -0,0 +1,71 @@
+
+#include <gtest/gtest.h>
+#include "memo_cache.h"
+
+using namespace mpits;
+
+namespace {
+
+	MemoCache::Call call(KernelRegistry::KernelID kernel, const std::string& args="") { 
+		return MemoCache::Call{kernel, args}; 
+	}
+
+} // end anonymous namespace
+
+TEST(MemoCache, Key) {
+
+	std::string args("\x01\x02\x03", 3);
+
+	EXPECT_EQ(MemoCache::key(call(1, args)), MemoCache::key(call(1, args)));
+	EXPECT_NE(MemoCache::key(call(1, args)), MemoCache::key(call(2, args)));
+	EXPECT_NE(MemoCache::key(call(1, args)), MemoCache::key(call(1, args.substr(0, 2))));
+}
+
+TEST(MemoCache, Lru) {
+
+	MemoCache cache(10);
+
+	cache.insert(call(1), "aaaa");
+	cache.insert(call(2), "bbbb");
+	EXPECT_EQ(8u, cache.used());
+
+	std::string result;
+	EXPECT_TRUE(cache.lookup(call(1), result));
+	EXPECT_EQ("aaaa", result);
+	EXPECT_FALSE(cache.lookup(call(3), result));
+	EXPECT_EQ(1u, cache.hits());
+
+	// 2 is the least recently used result
+	cache.insert(call(3), "cccc");
+	EXPECT_FALSE(cache.lookup(call(2), result));
+	EXPECT_TRUE(cache.lookup(call(3), result));
+	EXPECT_EQ(2u, cache.count());
+
+	// too large to be cached
+	cache.insert(call(4), std::string(11, 'd'));
+	EXPECT_FALSE(cache.lookup(call(4), result));
+	EXPECT_EQ(8u, cache.used());
+
+	// the empty result is a valid one
+	cache.insert(call(5), "");
+	EXPECT_TRUE(cache.lookup(call(5), result));
+	EXPECT_EQ("", result);
+}
+
+TEST(MemoCache, Args) {
+
+	MemoCache cache(100);
+
+	// the arguments are part of the entry and count towards the capacity
+	cache.insert(call(1, "xy"), "aaaa");
+	EXPECT_EQ(6u, cache.used());
+
+	std::string result;
+	EXPECT_TRUE(cache.lookup(call(1, "xy"), result));
+	EXPECT_FALSE(cache.lookup(call(1, "xz"), result));
+	EXPECT_FALSE(cache.lookup(call(2, "xy"), result));
+
+	// a call whose arguments alone exceed the capacity is not cached
+	cache.insert(call(1, std::string(100, 'x')), "");
+	EXPECT_EQ(1u, cache.count());
+}
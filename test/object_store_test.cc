@@ -0,0 +1,102 @@
+
+#include <gtest/gtest.h>
+#include "object_store.h"
+#include "utils/shm.h"
+
+using namespace mpits;
+
+TEST(ObjectStore, Lru) {
+
+	ObjectStore store(300);
+
+	EXPECT_TRUE(store.insert(1, 100, 4).empty());
+	EXPECT_TRUE(store.insert(2, 100).empty());
+	EXPECT_EQ(4, store.producer(1));
+	EXPECT_EQ(-1, store.producer(2));
+	EXPECT_TRUE(store.insert(3, 100).empty());
+	EXPECT_EQ(300u, store.used());
+
+	// object 1 was used last, 2 is the least recently used one
+	store.acquire(1);
+	EXPECT_TRUE(store.release(1).empty());
+
+	EXPECT_EQ(ObjectStore::ObjectList({2}), store.insert(4, 100));
+	EXPECT_FALSE(store.contains(2));
+	EXPECT_TRUE(store.contains(1));
+	EXPECT_EQ(3u, store.count());
+}
+
+TEST(ObjectStore, Refs) {
+
+	ObjectStore store(100);
+
+	store.insert(1, 60);
+	store.acquire(1);
+	store.acquire(1);
+
+	// mapped objects are kept, even above the capacity
+	EXPECT_TRUE(store.insert(2, 60).empty());
+	EXPECT_TRUE(store.release(1).empty());
+
+	// object 2 is more recent but object 1 was still mapped
+	EXPECT_EQ(ObjectStore::ObjectList({1}), store.release(1));
+	EXPECT_EQ(60u, store.used());
+
+	// a mapping can reach the store before the object itself
+	store.acquire(3);
+	EXPECT_FALSE(store.contains(3));
+	EXPECT_EQ(ObjectStore::ObjectList({2}), store.insert(3, 50));
+	EXPECT_TRUE(store.release(3).empty());
+
+	EXPECT_EQ(ObjectStore::ObjectList({3}), store.clear());
+	EXPECT_EQ(0u, store.used());
+}
+
+TEST(ObjectStore, Streams) {
+
+	ObjectStore store(100);
+
+	// rings are not objects, they take no room and are never evicted
+	store.insert_stream(5, 2);
+	EXPECT_TRUE(store.is_stream(5));
+	EXPECT_FALSE(store.contains(5));
+	EXPECT_EQ(2, store.producer(5));
+	EXPECT_TRUE(store.insert(1, 100).empty());
+	EXPECT_EQ(100u, store.used());
+
+	EXPECT_FALSE(store.stream_started(5));
+	store.start_stream(5);
+	EXPECT_TRUE(store.stream_started(5));
+
+	EXPECT_EQ(ObjectStore::ObjectList({1}), store.clear());
+	EXPECT_TRUE(store.is_stream(5));
+	EXPECT_EQ(ObjectStore::ObjectList({5}), store.clear_streams());
+	EXPECT_FALSE(store.is_stream(5));
+}
+
+TEST(ObjectStore, View) {
+
+	std::string data(10000, 'o');
+	ObjectRef ref = { ObjectStore::next_id(3), data.size() };
+	EXPECT_EQ(3u, ObjectStore::node_of(ref.id));
+	ASSERT_TRUE(utils::shm_create(ObjectStore::name(ref.id), data.data(), data.size()));
+
+	std::vector<ObjectID> released;
+	auto release = [&](const ObjectID& id) { released.push_back(id); };
+
+	{
+		ObjectView view(ref, release);
+		EXPECT_TRUE(view.valid());
+		EXPECT_EQ(data, std::string(view.data(), view.size()));
+
+		ObjectView moved(std::move(view));
+		EXPECT_TRUE(released.empty());
+	}
+	EXPECT_EQ(std::vector<ObjectID>({ref.id}), released);
+
+	utils::shm_remove(ObjectStore::name(ref.id));
+	EXPECT_FALSE(ObjectView(ref, release).valid());
+
+	// the null handle is the empty buffer
+	EXPECT_TRUE(ObjectView(ObjectRef{0, 0}, release).valid());
+}
@@ -0,0 +1,58 @@
+
+#include <gtest/gtest.h>
+#include "payload.h"
+
+using namespace mpits;
+
+TEST(Payload, Inline) {
+
+	EXPECT_TRUE(Payload::encode(std::string()).empty());
+	EXPECT_EQ(0u, Payload(std::string()).size());
+
+	std::string encoded = Payload::encode("abc", 16);
+	EXPECT_FALSE(Payload::is_shared(encoded));
+	EXPECT_EQ(3u, Payload::size(encoded));
+
+	// inline payloads are read in place
+	Payload view(encoded);
+	EXPECT_TRUE(view.valid());
+	EXPECT_EQ(encoded.data()+1, view.data());
+	EXPECT_EQ("abc", view.str());
+}
+
+TEST(Payload, Shared) {
+
+	std::string data(100000, 'x');
+	data[99999] = 'y';
+
+	std::string encoded = Payload::encode(data, 1024);
+	EXPECT_TRUE(Payload::is_shared(encoded));
+	EXPECT_LT(encoded.size(), 64u);
+	EXPECT_EQ(data.size(), Payload::size(encoded));
+
+	{
+		Payload view(encoded);
+		EXPECT_TRUE(view.valid());
+		EXPECT_EQ(data, view.str());
+
+		// the mapping survives the release of the object
+		Payload::release(encoded);
+		EXPECT_EQ('y', view.data()[99999]);
+	}
+
+	EXPECT_FALSE(Payload(encoded).valid());
+}
+
+TEST(Payload, MakeInline) {
+
+	std::string data(5000, 'z');
+	std::string encoded = Payload::encode(data, 1024);
+	ASSERT_TRUE(Payload::is_shared(encoded));
+
+	std::string moved = Payload::make_inline(encoded);
+	EXPECT_FALSE(Payload::is_shared(moved));
+	EXPECT_EQ(data, Payload(moved).str());
+
+	// the shared memory object is gone
+	EXPECT_FALSE(Payload(encoded).valid());
+}
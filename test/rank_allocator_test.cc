@@ -0,0 +1,126 @@
+
+#include <gtest/gtest.h>
+#include "rank_allocator.h"
+
+#include <vector>
+
+using namespace mpits;
+
+TEST(RankAllocator, InsertErase) {
+
+	RankAllocator alloc(200);
+	EXPECT_EQ(0u, alloc.count());
+
+	for (int rank=1; rank<200; ++rank) { alloc.insert(rank); }
+	EXPECT_EQ(199u, alloc.count());
+	EXPECT_FALSE(alloc.is_free(0));
+	EXPECT_TRUE(alloc.is_free(130));
+
+	alloc.erase(130);
+	EXPECT_FALSE(alloc.is_free(130));
+	EXPECT_EQ(198u, alloc.count());
+}
+
+TEST(RankAllocator, Any) {
+
+	RankAllocator alloc(8);
+	for (int rank : {1, 3, 5, 7}) { alloc.insert(rank); }
+
+	RankAllocator::RankList ranks;
+	EXPECT_FALSE(alloc.acquire(5, RankAllocator::RP_ANY, ranks));
+	EXPECT_TRUE(ranks.empty());
+
+	EXPECT_TRUE(alloc.acquire(3, RankAllocator::RP_ANY, ranks));
+	EXPECT_EQ(RankAllocator::RankList({1, 3, 5}), ranks);
+	EXPECT_EQ(1u, alloc.count());
+
+	alloc.release(ranks);
+	EXPECT_EQ(4u, alloc.count());
+}
+
+TEST(RankAllocator, Contiguous) {
+
+	RankAllocator alloc(256);
+	for (int rank=1; rank<256; ++rank) { alloc.insert(rank); }
+
+	// leave a hole of 3 ranks and a free range crossing the word boundary
+	for (int rank=4; rank<60; ++rank) { alloc.erase(rank); }
+	for (int rank=70; rank<256; ++rank) { alloc.erase(rank); }
+
+	RankAllocator::RankList ranks;
+	EXPECT_TRUE(alloc.acquire(8, RankAllocator::RP_CONTIGUOUS, ranks));
+	EXPECT_EQ(RankAllocator::RankList({60, 61, 62, 63, 64, 65, 66, 67}), ranks);
+
+	ranks.clear();
+	EXPECT_FALSE(alloc.acquire(4, RankAllocator::RP_CONTIGUOUS, ranks));
+	EXPECT_TRUE(alloc.acquire(3, RankAllocator::RP_CONTIGUOUS, ranks));
+	EXPECT_EQ(RankAllocator::RankList({1, 2, 3}), ranks);
+}
+
+TEST(RankAllocator, Domains) {
+
+	RankAllocator alloc(8);
+	for (int rank=1; rank<8; ++rank) { alloc.insert(rank); }
+
+	// two sockets, each with two NUMA nodes
+	alloc.set_domains({0, 0, 0, 0, 1, 1, 1, 1}, {0, 0, 1, 1, 2, 2, 3, 3});
+
+	// NUMA node 0 only has rank 1 free, best fit picks it
+	RankAllocator::RankList ranks;
+	EXPECT_TRUE(alloc.acquire(1, RankAllocator::RP_NUMA, ranks));
+	EXPECT_EQ(RankAllocator::RankList({1}), ranks);
+
+	ranks.clear();
+	EXPECT_FALSE(alloc.acquire(3, RankAllocator::RP_NUMA, ranks));
+	EXPECT_TRUE(alloc.acquire(3, RankAllocator::RP_SOCKET, ranks));
+	EXPECT_EQ(RankAllocator::RankList({4, 5, 6}), ranks);
+
+	// the best effort policy falls back to any free rank
+	ranks = alloc.acquire(3);
+	EXPECT_EQ(RankAllocator::RankList({2, 3, 7}), ranks);
+	EXPECT_TRUE(alloc.empty());
+}
+
+TEST(RankAllocator, Near) {
+
+	RankAllocator alloc(8);
+	for (int rank=1; rank<8; ++rank) { alloc.insert(rank); }
+	alloc.set_domains({0, 0, 0, 0, 1, 1, 1, 1}, {0, 0, 1, 1, 2, 2, 3, 3});
+
+	// the rank itself leads, followed by ranks of its NUMA node
+	EXPECT_EQ(RankAllocator::RankList({7, 6}), alloc.acquire_near(2, 7));
+
+	// NUMA node 2 is too small, the socket of rank 5 is used
+	EXPECT_EQ(RankAllocator::RankList({5, 4}), alloc.acquire_near(2, 5));
+
+	// the domains of a busy rank are still preferred
+	EXPECT_EQ(RankAllocator::RankList({1}), alloc.acquire_near(1, 0));
+
+	// no domain of rank 6 has free ranks left
+	EXPECT_EQ(RankAllocator::RankList({2, 3}), alloc.acquire_near(2, 6));
+	EXPECT_TRUE(alloc.empty());
+}
+
+TEST(RankAllocator, Pinned) {
+
+	RankAllocator alloc(8);
+	for (int rank=1; rank<8; ++rank) { alloc.insert(rank); }
+	alloc.set_domains({0, 0, 0, 0, 1, 1, 1, 1}, {0, 0, 1, 1, 2, 2, 3, 3});
+
+	alloc.pin(1);
+	alloc.pin(6);
+	EXPECT_TRUE(alloc.is_pinned(6));
+
+	// pinned ranks are left out while the others can host the request 
+	EXPECT_EQ(RankAllocator::RankList({7, 4}), alloc.acquire_near(2, 7));
+	EXPECT_EQ(RankAllocator::RankList({2, 3}), alloc.acquire(2));
+	EXPECT_TRUE(alloc.is_free(1) && alloc.is_free(6));
+
+	// they are taken when there is no other choice 
+	EXPECT_EQ(3u, alloc.acquire(3).size());
+	EXPECT_TRUE(alloc.empty());
+
+	alloc.unpin(6);
+	EXPECT_FALSE(alloc.is_pinned(6));
+	EXPECT_TRUE(alloc.is_pinned(1));
+}
@@ -0,0 +1,40 @@
+
+#include <gtest/gtest.h>
+#include "remote_tasks.h"
+
+using namespace mpits;
+
+TEST(RemoteTasks, Completed) {
+
+	RemoteTasks remote;
+	Task::TaskID tid = Task::make_tid(0, 1);
+
+	// stolen by another node, which runs it
+	remote.leave(tid);
+	EXPECT_TRUE(remote.contains(tid));
+	EXPECT_TRUE(remote.complete(tid));
+	EXPECT_FALSE(remote.contains(tid));
+	EXPECT_EQ(0u, remote.size());
+}
+
+TEST(RemoteTasks, StolenBack) {
+
+	RemoteTasks remote;
+	Task::TaskID tid = Task::make_tid(0, 2);
+
+	// forwarded to the node holding its inputs, then stolen back by the owner which runs 
+	// it: the local completion accounts for it
+	remote.leave(tid);
+	EXPECT_TRUE(remote.complete(tid));
+	EXPECT_FALSE(remote.contains(tid));
+
+	// tasks which never left complete locally as well
+	EXPECT_FALSE(remote.complete(Task::make_tid(0, 3)));
+
+	// stolen again by another node after being stolen back 
+	remote.leave(tid);
+	remote.leave(tid);
+	EXPECT_EQ(1u, remote.size());
+	EXPECT_TRUE(remote.complete(tid));
+	EXPECT_EQ(0u, remote.size());
+}
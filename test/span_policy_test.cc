@@ -0,0 +1,74 @@
+#include <gtest/gtest.h>
+#include "span_policy.h"
+
+using namespace mpits;
+
+namespace {
+
+	// Node holding all its free ranks for a co-allocation of its own
+	struct Node {
+		int 		rank;
+		unsigned 	held;
+		unsigned 	free;
+		unsigned 	needed;
+		bool 		yielded;
+	};
+
+	// Ranks granted by node to the reservation request of requester
+	unsigned reserve(Node& node, const Node& requester) {
+		if (node.held && !node.yielded && SpanPolicy::yields(node.rank, requester.rank)) {
+			node.free += node.held;
+			node.held = 0;
+			node.yielded = true;
+		}
+		unsigned n = std::min(node.free, requester.needed);
+		node.free -= n;
+		return n;
+	}
+
+} // end anonymous namespace
+
+TEST(SpanPolicy, TwoWideTasksOnTwoNodes) {
+
+	// 4 ranks per node, both nodes co-allocate a task of 6 ranks and ask each other at the
+	// same time
+	Node n0 = { 0, 4, 0, 2, false };
+	Node n1 = { 1, 4, 0, 2, false };
+
+	unsigned to0 = reserve(n1, n0);
+	unsigned to1 = reserve(n0, n1);
+
+	// node 1 gives way, the task of node 0 gets its ranks
+	EXPECT_FALSE(n0.yielded);
+	EXPECT_TRUE(n1.yielded);
+	EXPECT_EQ(2u, to0);
+	EXPECT_EQ(0u, to1);
+
+	// and the same whichever request is served first
+	n0 = { 0, 4, 0, 2, false };
+	n1 = { 1, 4, 0, 2, false };
+
+	EXPECT_EQ(0u, reserve(n0, n1));
+	EXPECT_EQ(2u, reserve(n1, n0));
+	EXPECT_TRUE(n1.yielded);
+}
+
+TEST(SpanPolicy, Order) {
+
+	EXPECT_TRUE(SpanPolicy::yields(1, 0));
+	EXPECT_FALSE(SpanPolicy::yields(0, 1));
+	EXPECT_FALSE(SpanPolicy::yields(2, 2));
+}
+
+TEST(SpanPolicy, RetryDelay) {
+
+	// the delay doubles with every failed attempt, within [delay/2, delay)
+	EXPECT_EQ(25u, SpanPolicy::retry_delay(50, 2000, 0, 0));
+	EXPECT_EQ(49u, SpanPolicy::retry_delay(50, 2000, 0, 0.999));
+	EXPECT_EQ(50u, SpanPolicy::retry_delay(50, 2000, 1, 0));
+	EXPECT_EQ(100u, SpanPolicy::retry_delay(50, 2000, 2, 0));
+
+	// up to the maximum
+	EXPECT_EQ(1000u, SpanPolicy::retry_delay(50, 2000, 10, 0));
+	EXPECT_EQ(1000u, SpanPolicy::retry_delay(50, 2000, 100, 0));
+}
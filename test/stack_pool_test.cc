@@ -0,0 +1,126 @@
+
+#include <gtest/gtest.h>
+#include "stack_pool.h"
+
+#include <unistd.h>
+
+using namespace mpits;
+
+TEST(StackPool, SizeClass) {
+
+	EXPECT_EQ(StackPool::MIN_STACK_SIZE, StackPool::size_class(0));
+	EXPECT_EQ(StackPool::MIN_STACK_SIZE, StackPool::size_class(1000));
+	EXPECT_EQ(StackPool::MIN_STACK_SIZE*2, StackPool::size_class(StackPool::MIN_STACK_SIZE+1));
+	EXPECT_EQ(1024u*1024u, StackPool::size_class(1000*1000));
+
+	StackPool pool(100*1024);
+	EXPECT_EQ(128u*1024u, pool.default_size());
+}
+
+TEST(StackPool, Reuse) {
+
+	StackPool pool(StackPool::MIN_STACK_SIZE);
+
+	void* s1 = pool.allocate();
+	void* s2 = pool.allocate();
+	EXPECT_NE(s1, s2);
+	EXPECT_EQ(2u, pool.mapped());
+
+	// the stack is usable down to its size
+	static_cast<char*>(s1)[-1] = 1;
+	static_cast<char*>(s1)[-static_cast<long>(pool.default_size())] = 1;
+
+	pool.deallocate(s1, pool.default_size());
+	pool.deallocate(s2, pool.default_size());
+	EXPECT_EQ(2u, pool.cached());
+
+	// last released, first reused 
+	EXPECT_EQ(s2, pool.allocate());
+	EXPECT_EQ(s1, pool.allocate());
+	EXPECT_EQ(2u, pool.mapped());
+	EXPECT_EQ(0u, pool.cached());
+
+	// a different size class maps a new stack 
+	void* s3 = pool.allocate(4*StackPool::MIN_STACK_SIZE);
+	EXPECT_EQ(3u, pool.mapped());
+
+	pool.deallocate(s1, pool.default_size());
+	pool.deallocate(s2, pool.default_size());
+	pool.deallocate(s3, 4*StackPool::MIN_STACK_SIZE);
+}
+
+TEST(StackPool, Reserve) {
+
+	StackPool pool(StackPool::MIN_STACK_SIZE);
+
+	EXPECT_TRUE(pool.reserve(pool.default_size()));
+	EXPECT_FALSE(pool.reserve(pool.default_size()));
+	EXPECT_EQ(1u, pool.mapped());
+	EXPECT_EQ(1u, pool.cached());
+
+	// the reserved stack is handed out, with its top already resident 
+	void* sp = pool.allocate();
+	EXPECT_EQ(1u, pool.mapped());
+	EXPECT_LE(StackPool::HOT_SIZE, StackPool::used(sp, pool.default_size()));
+
+	pool.deallocate(sp, pool.default_size());
+}
+
+TEST(StackPool, Trim) {
+
+	StackPool pool(StackPool::MIN_STACK_SIZE);
+
+	char* sp = static_cast<char*>(pool.allocate());
+	char* bottom = sp - pool.default_size();
+	bottom[0] = 1;
+	sp[-1] = 1;
+
+	// only whole pages below the address are released
+	EXPECT_EQ(0u, StackPool::trim(sp, pool.default_size(), bottom + 10));
+	EXPECT_EQ(pool.default_size()/2, StackPool::trim(sp, pool.default_size(), sp - pool.default_size()/2));
+	EXPECT_EQ(0, bottom[0]);
+	EXPECT_EQ(1, sp[-1]);
+
+	// the cold part of a released stack is returned to the system 
+	bottom[0] = 1;
+	pool.deallocate(sp, pool.default_size());
+	EXPECT_EQ(sp, pool.allocate());
+	EXPECT_EQ(0, bottom[0]);
+	EXPECT_EQ(1, sp[-1]);
+
+	pool.deallocate(sp, pool.default_size());
+}
+
+TEST(StackPool, Used) {
+
+	StackPool pool(4*StackPool::MIN_STACK_SIZE);
+
+	char* sp = static_cast<char*>(pool.allocate());
+	EXPECT_EQ(0u, StackPool::used(sp, pool.default_size()));
+
+	size_t depth = StackPool::MIN_STACK_SIZE + 100;
+	sp[-static_cast<long>(depth)] = 1;
+
+	size_t used = StackPool::used(sp, pool.default_size());
+	EXPECT_LE(depth, used);
+	EXPECT_GT(depth + sysconf(_SC_PAGESIZE), used);
+
+	// a recycled stack only keeps its hot part 
+	pool.deallocate(sp, pool.default_size());
+	EXPECT_EQ(sp, pool.allocate());
+	EXPECT_GE(StackPool::HOT_SIZE, StackPool::used(sp, pool.default_size()));
+
+	pool.deallocate(sp, pool.default_size());
+}
+
+TEST(StackPool, MaxCached) {
+
+	StackPool pool(StackPool::MIN_STACK_SIZE, 1);
+
+	void* s1 = pool.allocate();
+	void* s2 = pool.allocate();
+
+	pool.deallocate(s1, pool.default_size());
+	pool.deallocate(s2, pool.default_size());
+	EXPECT_EQ(1u, pool.cached());
+}
@@ -0,0 +1,138 @@
+
+#include <gtest/gtest.h>
+#include "staging.h"
+
+#include <chrono>
+#include <fstream>
+#include <sstream>
+
+#include <unistd.h>
+
+using namespace mpits;
+
+namespace {
+
+	std::string make_file(const std::string& name, size_t size) {
+		std::ostringstream ss;
+		ss << "/tmp/mpits_staging_test." << getpid() << "." << name;
+
+		std::ofstream out(ss.str());
+		out << std::string(size, name[0]);
+		return ss.str();
+	}
+
+	std::string read_file(const std::string& path) {
+		std::ifstream in(path);
+		return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+	}
+
+	bool wait_staged(const StagingCache& cache, const std::string& file) {
+		for (int i=0; i<1000 && !cache.staged(file); ++i) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		return cache.staged(file);
+	}
+
+} // end anonymous namespace
+
+TEST(StagingCache, Prefetch) {
+
+	std::string file = make_file("a", 1000);
+	StagingCache cache(10000);
+
+	// nothing staged yet, the original file is read
+	EXPECT_EQ(file, StagingCache::lookup(file));
+
+	cache.prefetch(file);
+	cache.prefetch(file);
+	ASSERT_TRUE(wait_staged(cache, file));
+	EXPECT_EQ(1000u, cache.used());
+
+	std::string staged = StagingCache::lookup(file);
+	EXPECT_EQ(StagingCache::path(file), staged);
+	EXPECT_EQ(read_file(file), read_file(staged));
+
+	cache.clear();
+	EXPECT_EQ(file, StagingCache::lookup(file));
+	unlink(file.c_str());
+}
+
+TEST(StagingCache, Lru) {
+
+	std::string a = make_file("a", 600), b = make_file("b", 600);
+	StagingCache cache(1000);
+
+	cache.prefetch(a);
+	ASSERT_TRUE(wait_staged(cache, a));
+
+	// pinned files are kept above the capacity
+	cache.prefetch(b);
+	ASSERT_TRUE(wait_staged(cache, b));
+	EXPECT_TRUE(cache.staged(a));
+	EXPECT_EQ(1200u, cache.used());
+
+	// a is the least recently used file
+	EXPECT_EQ(1u, cache.release(a));
+	EXPECT_EQ(0u, cache.release(b));
+	EXPECT_TRUE(cache.staged(b));
+	EXPECT_FALSE(cache.staged(a));
+	EXPECT_EQ(a, StagingCache::lookup(a));
+
+	cache.clear();
+	unlink(a.c_str());
+	unlink(b.c_str());
+}
+
+TEST(StagingCache, Stale) {
+
+	std::string file = make_file("d", 100);
+	StagingCache cache(10000);
+
+	// the copies of another run are never used
+	StagingCache::set_job(getpid()+1);
+	std::string other = StagingCache::path(file);
+	StagingCache::set_job(getpid());
+	EXPECT_NE(other, StagingCache::path(file));
+
+	cache.prefetch(file);
+	ASSERT_TRUE(wait_staged(cache, file));
+	EXPECT_EQ(StagingCache::path(file), StagingCache::lookup(file));
+
+	// the source changed after it was staged
+	std::ofstream(file) << std::string(200, 'e');
+	EXPECT_EQ(file, StagingCache::lookup(file));
+
+	// the outdated copy is replaced
+	size_t size = 0;
+	EXPECT_TRUE(StagingCache::copy(file, StagingCache::path(file), size));
+	EXPECT_EQ(200u, size);
+	EXPECT_EQ(StagingCache::path(file), StagingCache::lookup(file));
+	EXPECT_EQ(read_file(file), read_file(StagingCache::path(file)));
+
+	cache.clear();
+	unlink(file.c_str());
+}
+
+TEST(StagingCache, InputFile) {
+
+	std::string file = make_file("c", 100);
+	StagingCache cache(10000);
+
+	std::tuple<InputFile, int> args(InputFile{file}, 3);
+	std::string packed = detail::pack_args(args);
+
+	// the kernel receives the staged copy once present
+	std::tuple<InputFile, int> values;
+	detail::unpack_tuple(packed.data(), values, detail::MakeIndices<2>::type());
+	EXPECT_EQ(file, std::get<0>(values).path);
+	EXPECT_EQ(3, std::get<1>(values));
+
+	cache.prefetch(file);
+	ASSERT_TRUE(wait_staged(cache, file));
+
+	detail::unpack_tuple(packed.data(), values, detail::MakeIndices<2>::type());
+	EXPECT_EQ(StagingCache::path(file), std::get<0>(values).path);
+
+	cache.clear();
+	unlink(file.c_str());
+}
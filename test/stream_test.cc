@@ -0,0 +1,86 @@
+
+#include <gtest/gtest.h>
+#include "stream.h"
+
+#include <thread>
+
+using namespace mpits;
+
+TEST(Stream, Chunks) {
+
+	StreamRef ref = Stream::create(100);
+	ASSERT_NE(0u, ref.id);
+	EXPECT_EQ(128u, ref.capacity);
+
+	Stream writer(ref, Stream::WRITER);
+	Stream reader(ref, Stream::READER);
+	ASSERT_TRUE(writer.valid() && reader.valid());
+
+	std::string chunk;
+	EXPECT_FALSE(reader.try_read(chunk));
+
+	// chunks take 8 bytes of header plus their size rounded to 8 bytes: 56 + 32 + 56 > 128
+	std::string data(45, 'a'), small(17, 'b');
+	EXPECT_TRUE(writer.try_write(data.data(), data.size()));
+	EXPECT_TRUE(writer.try_write(small.data(), small.size()));
+	EXPECT_FALSE(writer.try_write(data.data(), data.size()));
+
+	EXPECT_TRUE(reader.try_read(chunk));
+	EXPECT_EQ(data, chunk);
+
+	// the chunk wraps around the end of the ring
+	EXPECT_TRUE(writer.try_write(data.data(), data.size()));
+	EXPECT_TRUE(reader.try_read(chunk));
+	EXPECT_EQ(small, chunk);
+	EXPECT_TRUE(reader.try_read(chunk));
+	EXPECT_EQ(data, chunk);
+
+	// a chunk larger than the ring is refused instead of waiting forever
+	std::string large(200, 'c');
+	EXPECT_FALSE(writer.try_write(large.data(), large.size()));
+	EXPECT_FALSE(writer.write(large.data(), large.size()));
+
+	writer.close();
+	EXPECT_TRUE(reader.eof());
+	EXPECT_FALSE(reader.read(chunk));
+}
+
+TEST(Stream, Typed) {
+
+	StreamRef ref = Stream::create(256);
+
+	// the ring is much smaller than the stream, the writer waits for the reader
+	std::thread producer([ref]() {
+		StreamWriter<std::vector<int>> writer(ref);
+		for (int i=0; i<1000; ++i) { writer.push(std::vector<int>(i%10, i)); }
+		writer.close();
+	});
+
+	StreamReader<std::vector<int>> reader(ref);
+	ASSERT_TRUE(reader.valid());
+
+	int count = 0;
+	std::vector<int> values;
+	while (reader.pop(values)) {
+		EXPECT_EQ(std::vector<int>(count%10, count), values);
+		++count;
+	}
+	EXPECT_EQ(1000, count);
+
+	producer.join();
+}
+
+TEST(Stream, ReaderGone) {
+
+	StreamRef ref = Stream::create(64);
+	Stream writer(ref, Stream::WRITER);
+
+	{
+		Stream reader(ref, Stream::READER);
+		EXPECT_TRUE(writer.write("x", 1));
+	}
+
+	// pending and later writes fail, the ring is removed
+	EXPECT_FALSE(writer.write("y", 1));
+	EXPECT_FALSE(Stream(ref, Stream::READER).valid());
+}